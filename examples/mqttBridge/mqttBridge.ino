@@ -6,6 +6,8 @@
 // When you publish "getNodes" to "painlessMesh/to/gateway" you receive the mesh topology as JSON
 // Every message from the mesh which is send to the gateway node will be published to "painlessMesh/from/12345678" where 12345678 
 // is the nodeId from which the packet was send.
+// Changes in the mesh topology are published to "painlessMesh/from/gateway/topology" as
+// "joined 12345678", "left 12345678", "moved 12345678" or "root 12345678".
 //************************************************************
 
 #include <Arduino.h>
@@ -24,6 +26,7 @@
 
 // Prototypes
 void receivedCallback( const uint32_t &from, const String &msg );
+void topologyCallback( const painlessmesh::layout::TopologyEvent &event );
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 
 IPAddress getlocalIP();
@@ -44,6 +47,7 @@ void setup() {
   // network (STATION_SSID)
   mesh.init( MESH_PREFIX, MESH_PASSWORD, MESH_PORT, WIFI_AP_STA, 6 );
   mesh.onReceive(&receivedCallback);
+  mesh.onTopologyEvent(&topologyCallback);
 
   mesh.stationManual(STATION_SSID, STATION_PASSWORD);
   mesh.setHostname(HOSTNAME);
@@ -75,6 +79,19 @@ void receivedCallback( const uint32_t &from, const String &msg ) {
   mqttClient.publish(topic.c_str(), msg.c_str());
 }
 
+void topologyCallback( const painlessmesh::layout::TopologyEvent &event ) {
+  using painlessmesh::layout::TopologyEvent;
+  String str;
+  switch (event.type) {
+    case TopologyEvent::JOINED: str = "joined "; break;
+    case TopologyEvent::LEFT: str = "left "; break;
+    case TopologyEvent::MOVED: str = "moved "; break;
+    case TopologyEvent::ROOT_CHANGED: str = "root "; break;
+  }
+  str += String(event.nodeId);
+  mqttClient.publish("painlessMesh/from/gateway/topology", str.c_str());
+}
+
 void mqttCallback(char* topic, uint8_t* payload, unsigned int length) {
   char* cleanPayload = (char*)malloc(length+1);
   memcpy(cleanPayload, payload, length);
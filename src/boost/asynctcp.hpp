@@ -3,7 +3,9 @@
 
 #include <boost/array.hpp>
 #include <boost/asio.hpp>
+#include <atomic>
 #include <iostream>
+#include <memory>
 
 #ifndef TCP_MSS
 #define TCP_MSS 1024
@@ -28,39 +30,71 @@ typedef std::function<void(void*, AsyncClient*, uint32_t time)>
 
 typedef boost::asio::ip::address IPAddress;
 
+/**
+ * Hands the callbacks of clients and servers to the thread that runs the mesh
+ *
+ * Without a dispatcher all callbacks are called directly from the thread that
+ * polls the io_service, which then has to be the thread that runs the mesh as
+ * well. With a dispatcher (see boost/runtime.hpp) the sockets can be serviced
+ * by other threads.
+ */
+class AsyncDispatcher {
+ public:
+  virtual ~AsyncDispatcher() {}
+
+  /**
+   * Called on an io thread, fn should be called on the mesh thread
+   */
+  virtual void deliver(std::function<void()> fn) = 0;
+
+  /**
+   * The io_service a new client should use
+   */
+  virtual boost::asio::io_service& next() = 0;
+};
+
 class AsyncClient {
  public:
-  AsyncClient(boost::asio::io_service& io_service)
-      : _io_service(io_service), mSocket(_io_service) {}
+  AsyncClient(boost::asio::io_service& io_service,
+              AsyncDispatcher* dispatcher = NULL)
+      : _io_service(io_service),
+        io(std::make_shared<Io>(io_service, this, dispatcher)) {
+    io->owner = alive;
+  }
 
   bool connect(IPAddress ipaddress, uint16_t port) {
     namespace ip = boost::asio::ip;
     auto endpoint = ip::tcp::endpoint(ipaddress, port);
 
-    mSocket.async_connect(endpoint, [&](const auto& ec) { this->handleConnect(ec); });
+    post([io = this->io, endpoint]() {
+      io->socket.async_connect(
+          endpoint, [io](const auto& ec) { handleConnect(io, ec); });
+    });
     return true;
   }
 
   void initRead() {
-    mSocket.async_read_some(
-        boost::asio::buffer(mInputBuffer, TCP_MSS),
-        [&](const auto& ec, auto len) { this->handleData(ec, len); });
+    post([io = this->io]() {
+      if (!io->open) return;
+      io->socket.async_read_some(
+          boost::asio::buffer(io->inputBuffer, TCP_MSS),
+          [io](const auto& ec, auto len) { handleData(io, ec, len); });
+    });
   }
 
   size_t write(const void* data, size_t len,
                size_t copy = ASYNC_WRITE_FLAG_COPY) {
-    if (writing) return 0;
-    writing = true;
+    if (io->writing) return 0;
+    io->writing = true;
     if (copy == ASYNC_WRITE_FLAG_COPY) {
-      memcpy(mWriteBuffer, data, len);
-      mSocket.async_send(
-          boost::asio::buffer(mWriteBuffer, len),
-          [&](const auto& ec, auto len) { this->handleWrite(ec, len); });
-    } else {
-      mSocket.async_send(
-          boost::asio::buffer(data, len),
-          [&](const auto& ec, auto len) { this->handleWrite(ec, len); });
+      memcpy(io->writeBuffer, data, len);
+      data = io->writeBuffer;
     }
+    post([io = this->io, data, len]() {
+      io->socket.async_send(
+          boost::asio::buffer(data, len),
+          [io](const auto& ec, auto len) { handleWrite(io, ec, len); });
+    });
     return len;
   }
 
@@ -108,13 +142,15 @@ class AsyncClient {
     _poll_cb_arg = arg;
   }
 
-  bool connected() { return mSocket.is_open(); }
+  bool connected() { return io->open; }
 
   bool freeable() { return !this->connected(); }
 
   void close(bool now = true) {
-    if (this->connected()) {
-      mSocket.close();
+    if (!closeCalled) {
+      closeCalled = true;
+      io->open = false;
+      post([io = this->io]() { io->close(); });
     }
     if (!disconnectCalled) {
       disconnectCalled = true;
@@ -128,7 +164,7 @@ class AsyncClient {
 
   size_t space() {
     // This could be more intelligent, but simple and safe for now
-    if (writing) return 0;
+    if (io->writing) return 0;
     return TCP_MSS;
   }
 
@@ -141,16 +177,42 @@ class AsyncClient {
     return len;
   }
 
-  tcp::socket& socket() { return mSocket; }
+  tcp::socket& socket() { return io->socket; }
 
  protected:
-  boost::asio::io_service& _io_service;
-  tcp::socket mSocket;
+  /**
+   * The part of the client that is used on the io thread
+   *
+   * The asio handlers hold on to it, so the mesh can delete the client at any
+   * time. The callbacks of the client are only called on the mesh thread, and
+   * only while the client (owner) still exists.
+   */
+  struct Io {
+    Io(boost::asio::io_service& io_service, AsyncClient* client,
+       AsyncDispatcher* dispatcher)
+        : socket(io_service), client(client), dispatcher(dispatcher) {}
+
+    void close() {
+      open = false;
+      if (socket.is_open()) socket.close();
+    }
+
+    tcp::socket socket;
+    AsyncClient* client;
+    AsyncDispatcher* dispatcher;
+    std::weak_ptr<bool> owner;
 
-  char mInputBuffer[TCP_MSS];
-  char mWriteBuffer[TCP_MSS];
-  bool writing = false;
+    char inputBuffer[TCP_MSS];
+    char writeBuffer[TCP_MSS];
+    std::atomic<bool> writing{false};
+    std::atomic<bool> open{false};
+  };
 
+  boost::asio::io_service& _io_service;
+  std::shared_ptr<Io> io;
+  std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+
+  bool closeCalled = false;
   bool disconnectCalled = false;
 
   AcConnectHandler _connect_cb = 0;
@@ -168,59 +230,107 @@ class AsyncClient {
   AcConnectHandler _poll_cb = 0;
   void* _poll_cb_arg = 0;
 
-  void handleConnect(const boost::system::error_code& ec) {
-    if (!ec) {
-      if (_connect_cb) _connect_cb(_connect_cb_arg, this);
+  /**
+   * Run fn on the io thread
+   */
+  void post(std::function<void()> fn) {
+    if (io->dispatcher)
+      _io_service.post(fn);
+    else
+      fn();
+  }
 
-      initRead();
+  /**
+   * Run fn on the mesh thread, unless the client is gone by then
+   */
+  static void deliver(const std::shared_ptr<Io>& io,
+                      std::function<void(AsyncClient*)> fn) {
+    auto guarded = [owner = io->owner, client = io->client, fn]() {
+      if (!owner.expired()) fn(client);
+    };
+    if (io->dispatcher)
+      io->dispatcher->deliver(guarded);
+    else
+      guarded();
+  }
+
+  // The handlers run on the io thread, so they only use io directly
+  static void handleConnect(std::shared_ptr<Io> io,
+                            const boost::system::error_code& ec) {
+    if (!ec) {
+      io->open = true;
+      deliver(io, [](AsyncClient* client) {
+        if (client->_connect_cb)
+          client->_connect_cb(client->_connect_cb_arg, client);
+        client->initRead();
+      });
     } else {
-      handleError(ec);
-      if (this->connected()) close(true);
+      handleError(io, ec);
     }
   }
 
-  void handleData(const boost::system::error_code& ec, size_t len) {
-    if (disconnectCalled) return;
+  static void handleData(std::shared_ptr<Io> io,
+                         const boost::system::error_code& ec, size_t len) {
+    if (!io->open) return;
 
     if (!ec) {
-      if (_recv_cb) {
-        _recv_cb(_recv_cb_arg, this, (void*)mInputBuffer, len);
-      }
+      // The next read is only started by ack(), so the input buffer is left
+      // alone until the data is handled
+      deliver(io, [len](AsyncClient* client) {
+        if (client->disconnectCalled) return;
+        if (client->_recv_cb) {
+          client->_recv_cb(client->_recv_cb_arg, client,
+                           (void*)client->io->inputBuffer, len);
+        }
+      });
     } else {
-      handleError(ec);
-      close(true);
+      handleError(io, ec);
     }
   }
 
-  void handleWrite(const boost::system::error_code& ec, size_t len) {
-    if (disconnectCalled) return;
+  static void handleWrite(std::shared_ptr<Io> io,
+                          const boost::system::error_code& ec, size_t len) {
+    if (!io->open) return;
 
     if (!ec) {
-      if (_sent_cb) {
-        // TODO send actual time
-        _sent_cb(_sent_cb_arg, this, len, 0);
-      }
-      writing = false;
+      io->writing = false;
+      deliver(io, [len](AsyncClient* client) {
+        if (client->disconnectCalled) return;
+        if (client->_sent_cb) {
+          // TODO send actual time
+          client->_sent_cb(client->_sent_cb_arg, client, len, 0);
+        }
+      });
     } else {
-      handleError(ec);
-      close(true);
+      handleError(io, ec);
     }
   }
 
-  void handleError(const boost::system::error_code& ec) {
-    if (ec != boost::asio::error::eof && _error_cb) {
-      _error_cb(_error_cb_arg, this, ec.value());
-    }
+  static void handleError(std::shared_ptr<Io> io,
+                          const boost::system::error_code& ec) {
+    io->close();
+    auto report = ec != boost::asio::error::eof;
+    int8_t err = ec.value();
+    deliver(io, [report, err](AsyncClient* client) {
+      if (report && client->_error_cb) {
+        client->_error_cb(client->_error_cb_arg, client, err);
+      }
+      client->close(true);
+    });
   }
+
+  friend class AsyncServer;
 };
 
 class AsyncServer {
  public:
-  AsyncServer(boost::asio::io_service& io_service, uint16_t port)
+  AsyncServer(boost::asio::io_service& io_service, uint16_t port,
+              AsyncDispatcher* dispatcher = NULL)
       : _io_service(io_service),
         // mSocket(io_service),
         _port(port),
-        mAcceptor(io_service) {}
+        mAcceptor(io_service),
+        dispatcher(dispatcher) {}
 
   ~AsyncServer() { this->end(); }
 
@@ -242,6 +352,7 @@ class AsyncServer {
   }
 
   // Acceptor stop?
+  // With a dispatcher, stop its io threads before calling this
   void end() { mAcceptor.close(); }
 
   // Dummy function for compatibility with ESPAsycnTCP
@@ -251,21 +362,35 @@ class AsyncServer {
   boost::asio::io_service& _io_service;
   uint16_t _port;
   tcp::acceptor mAcceptor;
+  AsyncDispatcher* dispatcher;
   AcConnectHandler _connect_cb = 0;
   void* _connect_cb_arg = 0;
 
   void initAccept() {
+    AsyncClient* client;
+    if (dispatcher) {
+      // Spread the clients over the io threads
+      client = new AsyncClient(dispatcher->next(), dispatcher);
+    } else {
 #if BOOST_VERSION < 106000
-    AsyncClient* client = new AsyncClient(mAcceptor.get_io_service());
+      client = new AsyncClient(mAcceptor.get_io_service());
 #else
-    AsyncClient* client = new AsyncClient((boost::asio::io_context&)(mAcceptor).get_executor().context());    
+      client = new AsyncClient((boost::asio::io_context&)(mAcceptor).get_executor().context());
 #endif
+    }
     mAcceptor.async_accept(
         client->socket(), [this, client](const boost::system::error_code& e) {
           if (!e && this->_connect_cb) {
-            this->_connect_cb(this->_connect_cb_arg, client);
+            client->io->open = true;
+            auto accepted = [this, client]() {
+              this->_connect_cb(this->_connect_cb_arg, client);
+              client->initRead();
+            };
+            if (dispatcher)
+              dispatcher->deliver(accepted);
+            else
+              accepted();
             this->initAccept();
-            client->initRead();
           } else
             std::cout << "Error: " << e.message() << std::endl;
         });
@@ -0,0 +1,225 @@
+#ifndef _BOOST_RUNTIME_HPP_
+#define _BOOST_RUNTIME_HPP_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "boost/asynctcp.hpp"
+
+#ifndef RUNTIME_QUEUE_SIZE
+#define RUNTIME_QUEUE_SIZE 256  // Callbacks that can wait per io thread
+#endif
+
+namespace painlessmesh {
+
+/**
+ * Running a mesh on a (multi core) host
+ */
+namespace host {
+
+/**
+ * Lock-free queue with a single producer thread and a single consumer thread
+ *
+ * Holds at most N - 1 items.
+ */
+template <class T, size_t N>
+class SPSCQueue {
+ public:
+  /**
+   * Add an item (producer only)
+   *
+   * @return false if the queue is full, item is left untouched then
+   */
+  bool push(T&& item) {
+    auto t = tail.load(std::memory_order_relaxed);
+    auto next = (t + 1) % N;
+    if (next == head.load(std::memory_order_acquire)) return false;
+    items[t] = std::move(item);
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Take the oldest item (consumer only)
+   *
+   * @return false if the queue is empty
+   */
+  bool pop(T& item) {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    item = std::move(items[h]);
+    items[h] = T();
+    head.store((h + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+ protected:
+  std::array<T, N> items;
+  std::atomic<size_t> head{0};
+  // Keep head and tail on separate cache lines, so the producer and the
+  // consumer do not invalidate each other's
+  char padding[64];
+  std::atomic<size_t> tail{0};
+};
+
+/**
+ * Runs the sockets of a mesh on a pool of io threads
+ *
+ * Every io thread runs its own io_service, and each client is bound to one of
+ * them, so the handlers of a client are never run concurrently. The callbacks
+ * of the clients are passed to the mesh thread through a lock-free queue per
+ * io thread, and are called in poll(). All mesh code therefore runs on the
+ * thread that calls poll() and Mesh::update(), so no locking is needed (the
+ * semaphoreTake() used on the ESP32 always succeeds on a host).
+ *
+ * \code
+ * painlessmesh::host::Runtime runtime(4);
+ * auto server = runtime.server(5555);
+ * painlessmesh::tcp::initServer<MeshConnection, PMesh>(*server, mesh);
+ * runtime.start();
+ * while (running) {
+ *   runtime.poll();
+ *   mesh.update();
+ * }
+ * runtime.stop();
+ * \endcode
+ *
+ * Stop the runtime before deleting the mesh, its servers and its clients.
+ */
+class Runtime : public AsyncDispatcher {
+ public:
+  /**
+   * @param threads The number of io threads (default: one per core)
+   */
+  explicit Runtime(size_t threads = 0) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i)
+      workers.push_back(std::unique_ptr<Worker>(new Worker(this)));
+  }
+
+  Runtime(const Runtime&) = delete;
+  Runtime& operator=(const Runtime&) = delete;
+
+  ~Runtime() { stop(); }
+
+  void start() {
+    stopped = false;
+    for (auto&& worker : workers) {
+      auto w = worker.get();
+      w->thread = std::thread([this, w]() {
+        current() = w;
+        w->io_service.run();
+        current() = NULL;
+      });
+    }
+  }
+
+  /**
+   * Stop the io threads and wait for them to finish
+   */
+  void stop() {
+    stopped = true;
+    for (auto&& worker : workers) worker->io_service.stop();
+    for (auto&& worker : workers) {
+      if (worker->thread.joinable()) worker->thread.join();
+    }
+  }
+
+  /**
+   * Call the callbacks delivered by the io threads (mesh thread only)
+   *
+   * @return The number of callbacks called
+   */
+  size_t poll() {
+    size_t n = 0;
+    std::function<void()> fn;
+    for (auto&& worker : workers) {
+      while (worker->queue.pop(fn)) {
+        fn();
+        ++n;
+      }
+    }
+    std::vector<std::function<void()>> others;
+    {
+      std::lock_guard<std::mutex> lock(othersMutex);
+      others.swap(otherQueue);
+    }
+    for (auto&& fn : others) {
+      fn();
+      ++n;
+    }
+    return n;
+  }
+
+  /**
+   * A new client, bound to one of the io threads
+   */
+  AsyncClient* client() { return new AsyncClient(next(), this); }
+
+  /**
+   * A new server, its clients are spread over the io threads
+   */
+  std::shared_ptr<AsyncServer> server(uint16_t port) {
+    return std::make_shared<AsyncServer>(next(), port, this);
+  }
+
+  size_t size() const { return workers.size(); }
+
+  void deliver(std::function<void()> fn) override {
+    auto w = current();
+    if (w == NULL || w->runtime != this) {
+      // Not called from one of our io threads
+      std::lock_guard<std::mutex> lock(othersMutex);
+      otherQueue.push_back(fn);
+      return;
+    }
+    // Flow control (a client only reads again after ack()) keeps the queues
+    // short, so a full queue means the mesh thread is busy. Wait for it.
+    while (!w->queue.push(std::move(fn))) {
+      if (stopped) return;
+      std::this_thread::yield();
+    }
+  }
+
+  boost::asio::io_service& next() override {
+    return workers[nextWorker++ % workers.size()]->io_service;
+  }
+
+ protected:
+  struct Worker {
+    Worker(Runtime* runtime) : runtime(runtime) {}
+
+    Runtime* runtime;
+    boost::asio::io_service io_service;
+    // Keeps run() going while there is nothing to do
+    boost::asio::io_service::work work{io_service};
+    SPSCQueue<std::function<void()>, RUNTIME_QUEUE_SIZE> queue;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<size_t> nextWorker{0};
+  std::atomic<bool> stopped{true};
+
+  std::mutex othersMutex;
+  std::vector<std::function<void()>> otherQueue;
+
+  /// The worker of the io thread we are running on
+  static Worker*& current() {
+    static thread_local Worker* worker = NULL;
+    return worker;
+  }
+};
+}  // namespace host
+}  // namespace painlessmesh
+#endif
@@ -71,6 +71,8 @@ void MeshConnection::initTCPCallbacks() {
       [self = this->shared_from_this()](void *arg, AsyncClient *client,
                                         void *data, size_t len) {
         using namespace logger;
+        // Time stamp the data as early as possible, it is used for time sync
+        auto receivedAt = micros();
         if (self->mesh->semaphoreTake()) {
           Log(COMMUNICATION, "Received Length: %zu, Remaining: %zu\n", len,self->lengthRemaining);
 
@@ -93,7 +95,8 @@ void MeshConnection::initTCPCallbacks() {
 
               if (lenLeft >= self->lengthRemaining) {
                 self->pushStdStr(
-                    self->readBuffer.substr(offset, self->lengthRemaining));
+                    self->readBuffer.substr(offset, self->lengthRemaining),
+                    receivedAt);
                 offset += self->lengthRemaining;
                 lenLeft -= self->lengthRemaining;
                 self->lengthRemaining = 0;
@@ -124,7 +127,7 @@ void MeshConnection::initTCPCallbacks() {
                                         size_t len, uint32_t time) {
         using namespace logger;
         if (self->mesh->semaphoreTake()) {
-          self->sentBufferTask.forceNextIteration();
+          self->mesh->reactor.writable(self);
           self->mesh->semaphoreGive();
         }
       },
@@ -145,10 +148,10 @@ void MeshConnection::initTCPCallbacks() {
       NULL);
 }
 
-void MeshConnection::pushStdStr(std::string str) {
+void MeshConnection::pushStdStr(std::string str, uint32_t receivedAt) {
   str.shrink_to_fit();
-  receiveBuffer.push(str);
-  readBufferTask.forceNextIteration();
+  receiveBuffer.push(str, receivedAt);
+  mesh->reactor.readable(this->shared_from_this());
 }
 
 void MeshConnection::initTasks() {
@@ -158,59 +161,38 @@ void MeshConnection::initTasks() {
     Log(CONNECTION, "Time out reached\n");
     self->close();
   });
-  mesh->mScheduler->addTask(timeOutTask);
+  mesh->timers.addTimer(timeOutTask);
 
   this->nodeSyncTask.set(
       TASK_MINUTE, TASK_FOREVER, [self = this->shared_from_this()]() {
         Log(SYNC, "nodeSyncTask(): request with %u\n", self->nodeId);
-        auto p = self->request(self->mesh->asNodeTree());
-        router::send<protocol::NodeSyncRequest, MeshConnection>(p, self);
+        router::sendNodeSync<painlessmesh::Mesh<MeshConnection>,
+                             MeshConnection>((*self->mesh), self);
         self->timeOutTask.disable();
         self->timeOutTask.restartDelayed();
       });
-  mesh->mScheduler->addTask(this->nodeSyncTask);
+  mesh->timers.addTimer(this->nodeSyncTask);
   if (station)
     this->nodeSyncTask.enable();
   else
     this->nodeSyncTask.enableDelayed(10 * TASK_SECOND);
 
+  // Reading and writing is done by the reactor of the mesh
   receiveBuffer = painlessmesh::buffer::ReceiveBuffer<TSTRING>();
-  readBufferTask.set(
-      TASK_SECOND, TASK_FOREVER, [self = this->shared_from_this()]() {
-        Log(GENERAL, "readBufferTask()\n");
-        if (!self->receiveBuffer.empty()) {
-          Log(GENERAL, "readBufferTask not empty()\n");
-          TSTRING frnt = self->receiveBuffer.front();
-          self->receiveBuffer.pop_front();
-          if (!self->receiveBuffer.empty())
-            self->readBufferTask.forceNextIteration();
-
-          Log(GENERAL, "popped front of recieve: %zu\n", frnt.size());
-          router::routePackage<MeshConnection>(
-              (*self->mesh), self->shared_from_this(), frnt,
-              self->mesh->callbackList, self->mesh->getNodeTime());
-          Log(GENERAL, "routed successfully\n");
-        }
+}
 
-        Log(GENERAL, "readBufferTask()...\n");
-      });
-  mesh->mScheduler->addTask(readBufferTask);
-  readBufferTask.enableDelayed();
-
-  sentBufferTask.set(
-      TASK_SECOND, TASK_FOREVER, [self = this->shared_from_this()]() {
-        Log(GENERAL, "sentBufferTask()\n");
-        if (!self->sentBuffer.empty() && self->client->canSend()) {
-          Log(GENERAL, "readBufferTask not empty() and can send\n");
-          auto ret = self->writeNext();
-          if (ret)
-            self->sentBufferTask.forceNextIteration();
-          else
-            self->sentBufferTask.delay(100 * TASK_MILLISECOND);
-        }
-      });
-  mesh->mScheduler->addTask(sentBufferTask);
-  sentBufferTask.enableDelayed();
+bool MeshConnection::readNext() {
+  using namespace logger;
+  if (receiveBuffer.empty()) return false;
+  TSTRING frnt = receiveBuffer.front();
+  auto receivedAt = receiveBuffer.frontReceivedAt();
+  receiveBuffer.pop_front();
+
+  Log(GENERAL, "readNext(): popped front of receive: %zu\n", frnt.size());
+  router::routePackage<MeshConnection>((*mesh), this->shared_from_this(),
+                                       std::move(frnt), mesh->callbackList,
+                                       mesh->nodeTimeAt(receivedAt));
+  return !receiveBuffer.empty();
 }
 
 void ICACHE_FLASH_ATTR MeshConnection::close() {
@@ -221,13 +203,9 @@ void ICACHE_FLASH_ATTR MeshConnection::close() {
 
   this->timeSyncTask.setCallback(NULL);
   this->nodeSyncTask.setCallback(NULL);
-  this->readBufferTask.setCallback(NULL);
-  this->sentBufferTask.setCallback(NULL);
   this->timeOutTask.setCallback(NULL);
   this->timeSyncTask.disable();
   this->nodeSyncTask.disable();
-  this->readBufferTask.disable();
-  this->sentBufferTask.disable();
   this->timeOutTask.disable();
 
   this->client->onDisconnect(NULL, NULL);
@@ -250,13 +228,14 @@ void ICACHE_FLASH_ATTR MeshConnection::close() {
 
   receiveBuffer.clear();
   sentBuffer.clear();
-  NodeTree::clear();
+  Neighbour::clear();
+  mesh->bumpVersion();
   Log(CONNECTION, "MeshConnection::close() done. Was station: %d.\n",
       this->station);
 }
 
 bool ICACHE_FLASH_ATTR MeshConnection::addMessage(std::string &message,
-                                                  bool priority) {
+                                                  bool priority, int stampAt) {
 #ifdef DEBUG
   // auto b64 = base64::encode(message);
   // Serial.printf("Trying to add message with size %zu, %s\n", message.size(),
@@ -273,28 +252,28 @@ bool ICACHE_FLASH_ATTR MeshConnection::addMessage(std::string &message,
           "addMessage(): Package sent to queue beginning -> %d , "
           "FreeMem: %d\n",
           sentBuffer.size(), ESP.getFreeHeap());
-      sentBuffer.push(message, priority);
+      sentBuffer.push(message, priority, stampAt);
     } else {
       if (sentBuffer.size() < MAX_MESSAGE_QUEUE) {
         Log(COMMUNICATION,
             "addMessage(): Package sent to queue end -> %d , FreeMem: "
             "%d\n",
             sentBuffer.size(), ESP.getFreeHeap());
-        sentBuffer.push(message, priority);
+        sentBuffer.push(message, priority, stampAt);
       } else {
         Log(ERROR, "addMessage(): Message queue full -> %d , FreeMem: %d\n",
             sentBuffer.size(), ESP.getFreeHeap());
-        sentBufferTask.forceNextIteration();
+        mesh->reactor.writable(this->shared_from_this());
         return false;
       }
     }
-    sentBufferTask.forceNextIteration();
+    mesh->reactor.writable(this->shared_from_this());
     return true;
   } else {
     // connection->sendQueue.clear(); // Discard all messages if free memory
     // is low
     Log(DEBUG, "addMessage(): Memory low, message was discarded\n");
-    sentBufferTask.forceNextIteration();
+    mesh->reactor.writable(this->shared_from_this());
     return false;
   }
 }
@@ -304,6 +283,7 @@ bool ICACHE_FLASH_ATTR MeshConnection::writeNext() {
     Log(COMMUNICATION, "writeNext(): sendQueue is empty\n");
     return false;
   }
+  if (!client->canSend()) return false;
   auto len = sentBuffer.requestLength(shared_buffer.length);
   auto snd_len = client->space();
   Log(COMMUNICATION, "Having space %zu and snd_len %zu\n", len, snd_len);
@@ -311,6 +291,8 @@ bool ICACHE_FLASH_ATTR MeshConnection::writeNext() {
   if (len > 0) {
     // sentBuffer.read(len, shared_buffer);
     // auto written = client->write(shared_buffer.buffer, len, 1);
+    // Time sync packages get their time stamp as late as possible
+    sentBuffer.stamp(mesh->getNodeTime());
     auto data_ptr = sentBuffer.readPtr(len);
 
     auto written = client->write(data_ptr, len, 1);
@@ -319,7 +301,6 @@ bool ICACHE_FLASH_ATTR MeshConnection::writeNext() {
       // Log(COMMUNICATION, "writeNext(): Package sent %s\n", data_ptr);
       // client->send();  // TODO only do this for priority messages
       sentBuffer.freeRead();
-      sentBufferTask.forceNextIteration();
       return true;
     } else if (written == 0) {
       Log(COMMUNICATION,
@@ -30,6 +30,8 @@ class MeshConnection : public painlessmesh::layout::Neighbour,
 
   bool newConnection = true;
   bool connected = true;
+  bool readQueued = false;
+  bool writeQueued = false;
   bool station = true;
   int lengthRemaining = 0;
   std::string readBuffer;
@@ -38,16 +40,22 @@ class MeshConnection : public painlessmesh::layout::Neighbour,
   // for timeout
   uint32_t timeDelayLastRequested = 0;
 
-  bool addMessage(std::string &message, bool priority = false);
+  bool addMessage(std::string &message, bool priority = false,
+                  int stampAt = -1);
   bool writeNext();
+  bool readNext();
+  bool hasPendingWrites() { return !sentBuffer.empty(); }
   painlessmesh::buffer::ReceiveBuffer<std::string> receiveBuffer;
   painlessmesh::buffer::SentBuffer<std::string> sentBuffer;
 
-  Task nodeSyncTask;
-  Task timeSyncTask;
-  Task readBufferTask;
-  Task sentBufferTask;
-  Task timeOutTask;
+  painlessmesh::timer::Timer nodeSyncTask;
+  painlessmesh::timer::Timer timeSyncTask;
+  painlessmesh::timer::Timer timeOutTask;
+
+  /// Samples of the running time sync burst
+  painlessmesh::ntp::SampleFilter timeSyncSamples;
+  /// Quality of the time sync with this neighbour
+  painlessmesh::ntp::SyncStats timeSyncStats;
 
   MeshConnection(AsyncClient *client, painlessmesh::Mesh<MeshConnection> *pMesh,
                  bool station);
@@ -55,7 +63,7 @@ class MeshConnection : public painlessmesh::layout::Neighbour,
 
   void initTCPCallbacks();
   void initTasks();
-  void pushStdStr(std::string str);
+  void pushStdStr(std::string str, uint32_t receivedAt);
 
   void handleMessage(std::string msg, uint32_t receivedAt);
 
@@ -56,9 +56,12 @@ class ReceiveBuffer {
   //   } while (length > 0);
   // }
 
-  void push(std::string cstr) {
-
+  /**
+   * \param receivedAt Local time (micros()) at which the message arrived
+   */
+  void push(std::string cstr, uint32_t receivedAt = 0) {
     jsonStrings.push_back(cstr);
+    receivedTimes.push_back(receivedAt);
   }
 
   /**
@@ -72,7 +75,18 @@ class ReceiveBuffer {
   /**
    * Remove the oldest message from the buffer
    */
-  void pop_front() { jsonStrings.pop_front(); }
+  void pop_front() {
+    jsonStrings.pop_front();
+    receivedTimes.pop_front();
+  }
+
+  /**
+   * The local time at which the oldest message arrived
+   */
+  uint32_t frontReceivedAt() {
+    if (!empty()) return receivedTimes.front();
+    return 0;
+  }
 
   /**
    * Is the buffer empty
@@ -84,12 +98,14 @@ class ReceiveBuffer {
    */
   void clear() {
     jsonStrings.clear();
+    receivedTimes.clear();
     buffer = T();
   }
 
  private:
   T buffer;
   std::list<T> jsonStrings;
+  std::list<uint32_t> receivedTimes;
 
   /**
    * Helper function to deal with difference Arduino String
@@ -129,15 +145,37 @@ class SentBuffer {
    * \param priority Whether this is a high priority message.
    *
    * High priority messages will be sent to the front of the buffer
+   *
+   * \param stampAt Position in the message of a time stamp that should be set
+   * when the message is actually written, see stamp(). -1 if none.
    */
-  void push(T message, bool priority = false) {
+  void push(T message, bool priority = false, int stampAt = -1) {
     if (priority) {
-      if (clean)
+      if (clean) {
         jsonStrings.push_front(message);
-      else
+        stamps.push_front(stampAt);
+      } else {
         jsonStrings.insert((++jsonStrings.begin()), message);
-    } else
+        stamps.insert((++stamps.begin()), stampAt);
+      }
+    } else {
       jsonStrings.push_back(message);
+      stamps.push_back(stampAt);
+    }
+  }
+
+  /**
+   * Write the time into the oldest message, if it has a time stamp (see
+   * push()) and none of it has been read yet
+   *
+   * Call this right before reading the message.
+   */
+  void stamp(uint32_t time) {
+    if (!clean || jsonStrings.empty() || stamps.front() < 0) return;
+    auto bytes = reinterpret_cast<const char *>(&time);
+    for (size_t i = 0; i < sizeof(time); ++i)
+      jsonStrings.front()[stamps.front() + i] = bytes[i];
+    stamps.front() = -1;
   }
 
   /**
@@ -196,6 +234,7 @@ class SentBuffer {
   void freeRead() {
     if (last_read_size == jsonStrings.begin()->length()) {
       jsonStrings.pop_front();
+      stamps.pop_front();
       clean = true;
     } else {
       // jsonStrings.begin()->remove(0, last_read_size);
@@ -207,7 +246,10 @@ class SentBuffer {
 
   bool empty() { return jsonStrings.empty(); }
 
-  void clear() { jsonStrings.clear(); }
+  void clear() {
+    jsonStrings.clear();
+    stamps.clear();
+  }
 
   size_t size() { return jsonStrings.size(); }
 
@@ -215,6 +257,7 @@ class SentBuffer {
   size_t last_read_size = 0;
   bool clean = true;
   std::list<T> jsonStrings;
+  std::list<int> stamps;
 
   inline void stringEraseFront(T &string, size_t length) {
     string.remove(0, length);
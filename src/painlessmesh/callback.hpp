@@ -1,7 +1,12 @@
 #ifndef _PAINLESS_MESH_CALLBACK_HPP_
 #define _PAINLESS_MESH_CALLBACK_HPP_
 
-#include<unordered_map>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "painlessmesh/configuration.hpp"
@@ -9,6 +14,14 @@
 #include "painlessmesh/logger.hpp"
 #include "painlessmesh/variant.hpp"
 
+#ifndef CALLBACK_INLINE_SIZE
+#define CALLBACK_INLINE_SIZE (4 * sizeof(void*))  // Inline callable size
+#endif
+
+#ifndef CALLBACK_TABLE_SIZE
+#define CALLBACK_TABLE_SIZE 32  // Package types with a table slot
+#endif
+
 extern painlessmesh::logger::LogClass Log;
 
 namespace painlessmesh {
@@ -45,30 +58,271 @@ class List {
     callbacks.push_back(func);
   }
 
+  size_t size() const { return callbacks.size(); }
+
  protected:
   std::vector<std::function<void(Args...)>> callbacks;
 };
 
+template <typename Signature>
+class Function;
+
+/**
+ * Callable wrapper similar to std::function
+ *
+ * Callables that fit in CALLBACK_INLINE_SIZE (e.g. lambdas capturing a few
+ * pointers) are stored inside the wrapper, only larger ones are allocated.
+ */
+template <typename R, typename... Args>
+class Function<R(Args...)> {
+ public:
+  Function() {}
+
+  template <typename C,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<C>::type, Function>::value>::type>
+  Function(C&& c) {
+    typedef typename std::decay<C>::type Callable;
+    ops = &opsFor<Callable>();
+    construct<Callable>(&storage, std::forward<C>(c), isInline<Callable>());
+  }
+
+  Function(const Function& other) : ops(other.ops) {
+    if (ops) ops->copy(&other.storage, &storage);
+  }
+
+  Function(Function&& other) : ops(other.ops) {
+    if (ops) ops->move(&other.storage, &storage);
+    other.ops = NULL;
+  }
+
+  Function& operator=(const Function& other) {
+    if (this != &other) {
+      reset();
+      ops = other.ops;
+      if (ops) ops->copy(&other.storage, &storage);
+    }
+    return (*this);
+  }
+
+  Function& operator=(Function&& other) {
+    if (this != &other) {
+      reset();
+      ops = other.ops;
+      if (ops) ops->move(&other.storage, &storage);
+      other.ops = NULL;
+    }
+    return (*this);
+  }
+
+  ~Function() { reset(); }
+
+  R operator()(Args... args) const {
+    return ops->invoke(&storage, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const { return ops != NULL; }
+
+  void reset() {
+    if (ops) ops->destroy(&storage);
+    ops = NULL;
+  }
+
+ protected:
+  typedef typename std::aligned_storage<CALLBACK_INLINE_SIZE,
+                                        alignof(void*)>::type Storage;
+
+  struct Ops {
+    R (*invoke)(const void*, Args&&...);
+    void (*copy)(const void*, void*);
+    void (*move)(void*, void*);
+    void (*destroy)(void*);
+  };
+
+  /// Whether the callable is stored in the wrapper or allocated
+  template <typename C>
+  using isInline = std::integral_constant<
+      bool, sizeof(C) <= sizeof(Storage) && alignof(C) <= alignof(Storage) &&
+                std::is_nothrow_move_constructible<C>::value>;
+
+  template <typename C, typename A>
+  static void construct(void* to, A&& c, std::true_type) {
+    new (to) C(std::forward<A>(c));
+  }
+  template <typename C, typename A>
+  static void construct(void* to, A&& c, std::false_type) {
+    new (to) C*(new C(std::forward<A>(c)));
+  }
+
+  template <typename C>
+  static C& get(void* storage, std::true_type) {
+    return *static_cast<C*>(storage);
+  }
+  template <typename C>
+  static C& get(void* storage, std::false_type) {
+    return **static_cast<C**>(storage);
+  }
+  template <typename C>
+  static C& get(const void* storage) {
+    return get<C>(const_cast<void*>(storage), isInline<C>());
+  }
+
+  template <typename C>
+  static void move(void* from, void* to, std::true_type) {
+    new (to) C(std::move(get<C>(from)));
+    get<C>(from).~C();
+  }
+  template <typename C>
+  static void move(void* from, void* to, std::false_type) {
+    new (to) C*(*static_cast<C**>(from));
+  }
+
+  template <typename C>
+  static void destroy(void* storage, std::true_type) {
+    get<C>(storage).~C();
+  }
+  template <typename C>
+  static void destroy(void* storage, std::false_type) {
+    delete &get<C>(storage);
+  }
+
+  template <typename C>
+  static R invoke(const void* storage, Args&&... args) {
+    return get<C>(storage)(std::forward<Args>(args)...);
+  }
+
+  template <typename C>
+  static void copy(const void* from, void* to) {
+    construct<C>(to, get<C>(from), isInline<C>());
+  }
+
+  template <typename C>
+  static void move(void* from, void* to) {
+    move<C>(from, to, isInline<C>());
+  }
+
+  template <typename C>
+  static void destroy(void* storage) {
+    destroy<C>(storage, isInline<C>());
+  }
+
+  template <typename C>
+  static const Ops& opsFor() {
+    static const Ops ops = {&invoke<C>, &copy<C>, &move<C>, &destroy<C>};
+    return ops;
+  }
+
+  const Ops* ops = NULL;
+  Storage storage;
+};
+
 /**
  * Manage callbacks for receiving packages
+ *
+ * The callbacks of a package type are called in order of priority (highest
+ * first), callbacks with the same priority in the order they were added. A
+ * callback that returns true consumes the package: the remaining callbacks are
+ * not called.
+ *
+ * Package types below CALLBACK_TABLE_SIZE are looked up directly in a table,
+ * higher types in a map.
  */
 template <typename... Args>
 class PackageCallbackList {
  public:
+  typedef Function<bool(Args...)> callback_t;
+
   /**
    * Add a callback for specific package id
+   *
+   * The callback should return true to stop any further handling of the
+   * package. Callbacks without a return value never stop it.
+   *
+   * A callback added while packages are being handled is only added once the
+   * handling is done, so it is not called for the current package.
    */
-  void onPackage(int id, std::function<void(Args...)> func) {
-    callbackMap[id].push_back(func);
+  template <typename C>
+  void onPackage(int id, C&& func, int priority = 0) {
+    Handler handler(
+        priority,
+        wrap(std::forward<C>(func),
+             std::is_void<decltype(func(std::declval<Args>()...))>()));
+    if (dispatching > 0) {
+      // Inserting now could move the callback that is running
+      pending.push_back(std::make_pair(id, std::move(handler)));
+      return;
+    }
+    insert(id, std::move(handler));
   }
 
   /**
-   * Execute all the callbacks associated with a certain package
+   * Execute the callbacks associated with a certain package
+   *
+   * @return The number of callbacks called
    */
-  int execute(int id, Args... args) { return callbackMap[id].execute(args...); }
+  int execute(int id, Args... args) {
+    auto handlers = find(id);
+    if (handlers == NULL) return 0;
+    ++dispatching;
+    size_t i = 0;
+    while (i < handlers->size()) {
+      if ((*handlers)[i++].callback(args...)) break;
+    }
+    if (--dispatching == 0 && !pending.empty()) {
+      for (auto&& p : pending) insert(p.first, std::move(p.second));
+      pending.clear();
+    }
+    return i;
+  }
 
  protected:
-  std::unordered_map<int, List<Args...>> callbackMap;
+  struct Handler {
+    Handler(int priority, callback_t callback)
+        : priority(priority), callback(std::move(callback)) {}
+
+    int priority;
+    callback_t callback;
+  };
+
+  std::array<std::vector<Handler>, CALLBACK_TABLE_SIZE> table;
+  std::map<int, std::vector<Handler>> overflow;
+
+  size_t dispatching = 0;
+  std::vector<std::pair<int, Handler>> pending;
+
+  void insert(int id, Handler&& handler) {
+    auto& handlers = slot(id);
+    auto priority = handler.priority;
+    auto it = std::upper_bound(
+        handlers.begin(), handlers.end(), priority,
+        [](int p, const Handler& handler) { return p > handler.priority; });
+    handlers.insert(it, std::move(handler));
+  }
+
+  std::vector<Handler>& slot(int id) {
+    if (id >= 0 && id < CALLBACK_TABLE_SIZE) return table[id];
+    return overflow[id];
+  }
+
+  std::vector<Handler>* find(int id) {
+    if (id >= 0 && id < CALLBACK_TABLE_SIZE) return &table[id];
+    auto it = overflow.find(id);
+    if (it == overflow.end()) return NULL;
+    return &it->second;
+  }
+
+  template <typename C>
+  static callback_t wrap(C&& func, std::false_type) {
+    return callback_t(std::forward<C>(func));
+  }
+
+  template <typename C>
+  static callback_t wrap(C&& func, std::true_type) {
+    return callback_t([func](Args... args) {
+      func(args...);
+      return false;
+    });
+  }
 };
 
 template <typename T>
@@ -78,4 +332,3 @@ using MeshPackageCallbackList =
 }  // namespace painlessmesh
 
 #endif
-
@@ -0,0 +1,168 @@
+#ifndef _PAINLESS_MESH_EXPORTER_HPP_
+#define _PAINLESS_MESH_EXPORTER_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+namespace painlessmesh {
+
+/**
+ * Write a (Node)Tree as JSON or CBOR to a sink
+ *
+ * A sink is any class with a write(const char* data, size_t length) member.
+ * The tree is written in a single pass, directly into the sink, without
+ * building any intermediate strings.
+ *
+ * The JSON format is the same as the one returned by NodeTree::toString, the
+ * CBOR format uses the same maps, keys and arrays.
+ */
+namespace exporter {
+
+/**
+ * Sink that writes into a caller provided buffer
+ *
+ * Data that does not fit is dropped, but still counted in length(), so after
+ * writing overflow() tells whether the buffer was large enough and length()
+ * how large it should have been.
+ */
+class BufferSink {
+ public:
+  BufferSink(char* buffer, size_t capacity)
+      : buffer(buffer), capacity(capacity) {}
+
+  void write(const char* data, size_t len) {
+    if (used < capacity) {
+      auto n = (capacity - used < len) ? capacity - used : len;
+      memcpy(buffer + used, data, n);
+    }
+    used += len;
+  }
+
+  /// Number of bytes written (or that would have been written)
+  size_t length() const { return used; }
+
+  bool overflow() const { return used > capacity; }
+
+ protected:
+  char* buffer;
+  size_t capacity;
+  size_t used = 0;
+};
+
+/**
+ * Sink that appends to a std::string
+ */
+class StringSink {
+ public:
+  StringSink(std::string& str) : str(str) {}
+
+  void write(const char* data, size_t len) { str.append(data, len); }
+
+ protected:
+  std::string& str;
+};
+
+template <class Sink>
+void writeUInt(uint32_t value, Sink& sink) {
+  char digits[10];
+  size_t i = sizeof(digits);
+  do {
+    digits[--i] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  sink.write(digits + i, sizeof(digits) - i);
+}
+
+template <class Sink>
+void writeIndent(size_t depth, Sink& sink) {
+  sink.write("\n", 1);
+  for (size_t i = 0; i < depth; ++i) sink.write("  ", 2);
+}
+
+/**
+ * Write the tree as JSON
+ *
+ * \param pretty Put every node on its own, indented, line
+ */
+template <class Tree, class Sink>
+void writeJson(const Tree& tree, Sink& sink, bool pretty = false,
+               size_t depth = 0) {
+  sink.write("{\"nodeId\":", 10);
+  writeUInt(tree.nodeId, sink);
+  if (tree.root) sink.write(",\"root\":true", 12);
+  if (!tree.subs.empty()) {
+    sink.write(",\"subs\":[", 9);
+    bool first = true;
+    for (auto&& sub : tree.subs) {
+      if (!first) sink.write(",", 1);
+      first = false;
+      if (pretty) writeIndent(depth + 1, sink);
+      writeJson(sub, sink, pretty, depth + 1);
+    }
+    if (pretty) writeIndent(depth, sink);
+    sink.write("]", 1);
+  }
+  sink.write("}", 1);
+}
+
+/**
+ * Write the header of a CBOR data item (RFC 7049 section 2.1)
+ */
+template <class Sink>
+void writeCborHeader(uint8_t majorType, uint32_t value, Sink& sink) {
+  char buf[5];
+  size_t len = 1;
+  if (value < 24) {
+    buf[0] = (majorType << 5) | value;
+  } else if (value <= 0xff) {
+    buf[0] = (majorType << 5) | 24;
+    buf[1] = value;
+    len = 2;
+  } else if (value <= 0xffff) {
+    buf[0] = (majorType << 5) | 25;
+    buf[1] = value >> 8;
+    buf[2] = value;
+    len = 3;
+  } else {
+    buf[0] = (majorType << 5) | 26;
+    buf[1] = value >> 24;
+    buf[2] = value >> 16;
+    buf[3] = value >> 8;
+    buf[4] = value;
+    len = 5;
+  }
+  sink.write(buf, len);
+}
+
+template <class Sink>
+void writeCborKey(const char* key, size_t len, Sink& sink) {
+  writeCborHeader(3, len, sink);
+  sink.write(key, len);
+}
+
+/**
+ * Write the tree as CBOR
+ */
+template <class Tree, class Sink>
+void writeCbor(const Tree& tree, Sink& sink) {
+  uint32_t noFields = 1;
+  if (tree.root) ++noFields;
+  if (!tree.subs.empty()) ++noFields;
+  writeCborHeader(5, noFields, sink);
+  writeCborKey("nodeId", 6, sink);
+  writeCborHeader(0, tree.nodeId, sink);
+  if (tree.root) {
+    writeCborKey("root", 4, sink);
+    sink.write("\xf5", 1);  // true
+  }
+  if (!tree.subs.empty()) {
+    writeCborKey("subs", 4, sink);
+    writeCborHeader(4, tree.subs.size(), sink);
+    for (auto&& sub : tree.subs) writeCbor(sub, sink);
+  }
+}
+
+}  // namespace exporter
+}  // namespace painlessmesh
+#endif
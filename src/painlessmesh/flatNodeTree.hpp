@@ -0,0 +1,196 @@
+#ifndef _PAINLESS_MESH_FLATNODETREE_HPP_
+#define _PAINLESS_MESH_FLATNODETREE_HPP_
+
+#include <list>
+#include <vector>
+
+#include "painlessmesh/nodeTree.hpp"
+
+namespace painlessmesh {
+namespace protocol {
+
+/**
+ * A node in a FlatNodeTree
+ */
+struct FlatNode {
+  enum Flags { ROOT = 1 << 0 };
+
+  uint32_t nodeId = 0;
+  uint8_t flags = 0;
+  /// Number of nodes in the subtree starting at this node (including itself)
+  uint16_t subtreeSize = 1;
+
+  FlatNode() {}
+  FlatNode(uint32_t nodeId, bool root, uint16_t subtreeSize = 1)
+      : nodeId(nodeId), flags(root ? ROOT : 0), subtreeSize(subtreeSize) {}
+
+  bool root() const { return flags & ROOT; }
+};
+
+/**
+ * Flat representation of a NodeTree
+ *
+ * All nodes are stored in one contiguous vector in preorder (a node is directly
+ * followed by its subs). Each node knows the size of its subtree, so the subs
+ * of a node can be found by jumping over the subtrees. Queries are linear scans
+ * over the vector and copying it is a single allocation, unlike the recursive
+ * NodeTree which allocates a list node for every node in the mesh.
+ *
+ * The serialized format is identical to that of NodeTree, so either can be used
+ * to read a package written by the other.
+ */
+class FlatNodeTree {
+ public:
+  std::vector<FlatNode> nodes;
+
+  FlatNodeTree() {}
+  FlatNodeTree(uint32_t nodeID, bool iAmRoot) {
+    nodes.push_back(FlatNode(nodeID, iAmRoot));
+  }
+
+  explicit FlatNodeTree(const NodeTree& tree) { append(tree); }
+
+  /**
+   * Convert back to the recursive representation
+   */
+  NodeTree toNodeTree() const {
+    NodeTree tree;
+    if (!nodes.empty()) toNodeTree(0, tree);
+    return tree;
+  }
+
+  /**
+   * Add the tree as a sub of the top node
+   *
+   * If this tree is empty the tree becomes the top node.
+   */
+  void append(const NodeTree& tree) {
+    auto isSub = !nodes.empty();
+    auto added = appendNodes(tree);
+    if (isSub) nodes.front().subtreeSize += added;
+  }
+
+  /**
+   * Add the flat tree as a sub of the top node
+   */
+  void append(const FlatNodeTree& tree) {
+    if (tree.nodes.empty()) return;
+    auto isSub = !nodes.empty();
+    nodes.insert(nodes.end(), tree.nodes.begin(), tree.nodes.end());
+    if (isSub) nodes.front().subtreeSize += tree.nodes.size();
+  }
+
+  uint32_t nodeId() const {
+    if (nodes.empty()) return 0;
+    return nodes.front().nodeId;
+  }
+
+  bool root() const { return !nodes.empty() && nodes.front().root(); }
+
+  /**
+   * The number of nodes in the tree
+   */
+  size_t size() const { return nodes.size(); }
+
+  bool empty() const { return nodes.empty(); }
+
+  /**
+   * Whether the tree contains the given nodeId
+   */
+  bool contains(uint32_t nodeId) const {
+    for (auto&& n : nodes) {
+      if (n.nodeId == nodeId) return true;
+    }
+    return false;
+  }
+
+  /**
+   * Whether any node in the tree is the root of the mesh
+   */
+  bool isRooted() const {
+    for (auto&& n : nodes) {
+      if (n.root()) return true;
+    }
+    return false;
+  }
+
+  /**
+   * Return all nodes in a list container
+   */
+  std::list<uint32_t> asList(bool includeSelf = true) const {
+    std::list<uint32_t> lst;
+    auto it = nodes.begin();
+    if (!includeSelf && it != nodes.end()) ++it;
+    for (; it != nodes.end(); ++it) lst.push_back(it->nodeId);
+    return lst;
+  }
+
+  /**
+   * Remove the subs of the top node with the given nodeId (and any subs with
+   * nodeId 0)
+   */
+  FlatNodeTree& excludeRoute(uint32_t exclude) {
+    if (nodes.empty()) return (*this);
+    size_t i = 1;
+    while (i < nodes.size()) {
+      auto len = nodes[i].subtreeSize;
+      if (nodes[i].nodeId == 0 || nodes[i].nodeId == exclude) {
+        nodes.erase(nodes.begin() + i, nodes.begin() + i + len);
+        nodes.front().subtreeSize -= len;
+      } else {
+        i += len;
+      }
+    }
+    return (*this);
+  }
+
+  /**
+   * The number of direct subs of the node at the given index
+   */
+  uint16_t noSubs(size_t index) const {
+    uint16_t no = 0;
+    auto end = index + nodes[index].subtreeSize;
+    for (auto i = index + 1; i < end; i += nodes[i].subtreeSize) ++no;
+    return no;
+  }
+
+  void clear() { nodes.clear(); }
+
+  bool operator==(const FlatNodeTree& b) const {
+    if (nodes.size() != b.nodes.size()) return false;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i].nodeId != b.nodes[i].nodeId ||
+          nodes[i].flags != b.nodes[i].flags ||
+          nodes[i].subtreeSize != b.nodes[i].subtreeSize)
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const FlatNodeTree& b) const { return !this->operator==(b); }
+
+ protected:
+  uint16_t appendNodes(const NodeTree& tree) {
+    auto index = nodes.size();
+    nodes.push_back(FlatNode(tree.nodeId, tree.root));
+    uint16_t size = 1;
+    for (auto&& s : tree.subs) size += appendNodes(s);
+    nodes[index].subtreeSize = size;
+    return size;
+  }
+
+  size_t toNodeTree(size_t index, NodeTree& tree) const {
+    tree.nodeId = nodes[index].nodeId;
+    tree.root = nodes[index].root();
+    auto end = index + nodes[index].subtreeSize;
+    auto i = index + 1;
+    while (i < end) {
+      tree.subs.push_back(NodeTree());
+      i = toNodeTree(i, tree.subs.back());
+    }
+    return end;
+  }
+};
+}  // namespace protocol
+}  // namespace painlessmesh
+#endif
@@ -1,9 +1,13 @@
 #ifndef _PAINLESS_MESH_LAYOUT_HPP_
 #define _PAINLESS_MESH_LAYOUT_HPP_
 
+#include <algorithm>
 #include <list>
+#include <map>
 #include <memory>
+#include <vector>
 
+#include "painlessmesh/flatNodeTree.hpp"
 #include "painlessmesh/protocol.hpp"
 
 namespace painlessmesh {
@@ -13,7 +17,7 @@ namespace layout {
 /**
  * Whether the tree contains the given nodeId
  */
-inline bool contains(protocol::NodeTree nodeTree, uint32_t nodeId) {
+inline bool contains(const protocol::NodeTree& nodeTree, uint32_t nodeId) {
   if (nodeTree.nodeId == nodeId) {
     return true;
   }
@@ -27,10 +31,347 @@ inline protocol::NodeTree excludeRoute(protocol::NodeTree&& tree,
                                        uint32_t exclude) {
   // Make sure to exclude any subs with nodeId == 0,
   // even if exlude is not set to zero
-  tree.subs.remove_if([exclude](protocol::NodeTree s) {
+  tree.subs.remove_if([exclude](const protocol::NodeTree& s) {
     return s.nodeId == 0 || s.nodeId == exclude;
   });
-  return tree;
+  return std::move(tree);
+}
+
+/**
+ * Copy of the tree without the route to exclude
+ *
+ * Only the subs that are kept are copied.
+ */
+inline protocol::NodeTree excludeRoute(const protocol::NodeTree& tree,
+                                       uint32_t exclude) {
+  protocol::NodeTree subTree(tree.nodeId, tree.root);
+  for (auto&& s : tree.subs) {
+    if (s.nodeId != 0 && s.nodeId != exclude) subTree.subs.push_back(s);
+  }
+  return subTree;
+}
+
+/**
+ * Find the node with the given nodeId in the tree
+ *
+ * \return nullptr if the tree does not contain the node
+ */
+inline protocol::NodeTree* find(protocol::NodeTree& nodeTree,
+                                uint32_t nodeId) {
+  if (nodeTree.nodeId == nodeId) return &nodeTree;
+  for (auto&& s : nodeTree.subs) {
+    auto node = find(s, nodeId);
+    if (node) return node;
+  }
+  return nullptr;
+}
+
+/**
+ * The nodes on the way from the top of the tree (exclusive) to the node with
+ * the given nodeId (inclusive)
+ *
+ * \return false if the tree does not contain the node
+ */
+inline bool findPath(const protocol::NodeTree& nodeTree, uint32_t nodeId,
+                     std::vector<const protocol::NodeTree*>& path) {
+  if (nodeTree.nodeId == nodeId) return true;
+  for (auto&& s : nodeTree.subs) {
+    path.push_back(&s);
+    if (findPath(s, nodeId, path)) return true;
+    path.pop_back();
+  }
+  return false;
+}
+
+/**
+ * Find the node with the given nodeId in the tree in order to change it
+ *
+ * The tree is searched without changing it, so only the cached hashes of the
+ * ancestors of the node are dropped.
+ */
+inline protocol::NodeTree* findForUpdate(protocol::NodeTree& nodeTree,
+                                         uint32_t nodeId) {
+  std::vector<const protocol::NodeTree*> path;
+  if (!findPath(nodeTree, nodeId, path)) return nullptr;
+  auto node = &nodeTree;
+  for (auto&& next : path) {
+    node = &*std::find_if(
+        node->subs.begin(), node->subs.end(),
+        [next](const protocol::NodeTree& s) { return &s == next; });
+  }
+  return node;
+}
+
+inline void diff(const protocol::NodeTree& from, const protocol::NodeTree& to,
+                 std::list<protocol::NodeTreeChange>& removed,
+                 std::list<protocol::NodeTreeChange>& added) {
+  using namespace protocol;
+  // Identical subtrees have identical hashes, no need to look any further
+  if (from == to) return;
+  for (auto&& old : from.subs) {
+    auto match = std::find_if(
+        to.subs.begin(), to.subs.end(),
+        [&old](const NodeTree& s) { return s.nodeId == old.nodeId; });
+    if (match == to.subs.end() || match->root != old.root)
+      removed.push_back(NodeTreeChange(NodeTreeChange::REMOVE, from.nodeId,
+                                       NodeTree(old.nodeId, old.root)));
+  }
+  for (auto&& sub : to.subs) {
+    auto match = std::find_if(
+        from.subs.begin(), from.subs.end(),
+        [&sub](const NodeTree& s) { return s.nodeId == sub.nodeId; });
+    if (match == from.subs.end() || match->root != sub.root)
+      added.push_back(NodeTreeChange(NodeTreeChange::ADD, to.nodeId, sub));
+    else
+      diff((*match), sub, removed, added);
+  }
+}
+
+/**
+ * The changes needed to turn excludeRoute(from, exclude) into
+ * excludeRoute(to, exclude), without making those copies
+ */
+inline std::list<protocol::NodeTreeChange> diff(const protocol::NodeTree& from,
+                                                const protocol::NodeTree& to,
+                                                uint32_t exclude) {
+  using namespace protocol;
+  std::list<NodeTreeChange> removed;
+  std::list<NodeTreeChange> added;
+  auto excluded = [exclude](const NodeTree& s) {
+    return s.nodeId == 0 || s.nodeId == exclude;
+  };
+  if (from != to) {
+    for (auto&& old : from.subs) {
+      if (excluded(old)) continue;
+      auto match = std::find_if(
+          to.subs.begin(), to.subs.end(),
+          [&old](const NodeTree& s) { return s.nodeId == old.nodeId; });
+      if (match == to.subs.end() || match->root != old.root)
+        removed.push_back(NodeTreeChange(NodeTreeChange::REMOVE, from.nodeId,
+                                         NodeTree(old.nodeId, old.root)));
+    }
+    for (auto&& sub : to.subs) {
+      if (excluded(sub)) continue;
+      auto match = std::find_if(
+          from.subs.begin(), from.subs.end(),
+          [&sub](const NodeTree& s) { return s.nodeId == sub.nodeId; });
+      if (match == from.subs.end() || match->root != sub.root)
+        added.push_back(NodeTreeChange(NodeTreeChange::ADD, to.nodeId, sub));
+      else
+        diff((*match), sub, removed, added);
+    }
+  }
+  removed.splice(removed.end(), added);
+  return removed;
+}
+
+/**
+ * The changes needed to turn one tree into another
+ *
+ * Subs are matched on nodeId, so the order of the subs is ignored. All the
+ * removals come before the additions, which means that applying them in order
+ * never leaves a node in the tree twice.
+ *
+ * Both trees should have the same top node.
+ */
+inline std::list<protocol::NodeTreeChange> diff(const protocol::NodeTree& from,
+                                                const protocol::NodeTree& to) {
+  std::list<protocol::NodeTreeChange> removed;
+  std::list<protocol::NodeTreeChange> added;
+  diff(from, to, removed, added);
+  removed.splice(removed.end(), added);
+  return removed;
+}
+
+/**
+ * Apply the changes (see diff()) to the tree
+ *
+ * \return false if a change refers to a node that is not in the tree. The tree
+ * is then left in an undefined state.
+ */
+inline bool apply(protocol::NodeTree& tree,
+                  const std::list<protocol::NodeTreeChange>& changes) {
+  using namespace protocol;
+  for (auto&& change : changes) {
+    auto parent = findForUpdate(tree, change.parentId);
+    if (!parent) return false;
+    if (change.op == NodeTreeChange::ADD) {
+      parent->subs.push_back(change.subtree);
+    } else if (change.op == NodeTreeChange::REMOVE) {
+      auto size = parent->subs.size();
+      parent->subs.remove_if([&change](const NodeTree& s) {
+        return s.nodeId == change.subtree.nodeId;
+      });
+      if (parent->subs.size() == size) return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Undo changes made by apply(tree, changes, undo)
+ *
+ * \param undo The undo record filled by apply(), it is consumed
+ */
+inline void revert(protocol::NodeTree& tree,
+                   std::list<protocol::NodeTreeChange>&& undo) {
+  using namespace protocol;
+  for (auto&& change : undo) {
+    auto parent = findForUpdate(tree, change.parentId);
+    if (!parent) continue;
+    if (change.op == NodeTreeChange::ADD) {
+      parent->subs.push_back(std::move(change.subtree));
+    } else {
+      // Added subs were appended, so the last match is the one we added
+      for (auto it = parent->subs.end(); it != parent->subs.begin();) {
+        --it;
+        if (it->nodeId == change.subtree.nodeId) {
+          parent->subs.erase(it);
+          break;
+        }
+      }
+    }
+  }
+  undo.clear();
+}
+
+/**
+ * Apply the changes (see diff()) to the tree, keeping a record to undo them
+ *
+ * \param undo Will hold the changes that turn the tree back into what it was,
+ * see revert()
+ *
+ * \return false if a change refers to a node that is not in the tree. The
+ * tree is then left as it was.
+ */
+inline bool apply(protocol::NodeTree& tree,
+                  const std::list<protocol::NodeTreeChange>& changes,
+                  std::list<protocol::NodeTreeChange>& undo) {
+  using namespace protocol;
+  for (auto&& change : changes) {
+    auto parent = findForUpdate(tree, change.parentId);
+    auto found = false;
+    if (parent && change.op == NodeTreeChange::ADD) {
+      parent->subs.push_back(change.subtree);
+      undo.push_front(NodeTreeChange(
+          NodeTreeChange::REMOVE, change.parentId,
+          NodeTree(change.subtree.nodeId, change.subtree.root)));
+      found = true;
+    } else if (parent && change.op == NodeTreeChange::REMOVE) {
+      for (auto it = parent->subs.begin(); it != parent->subs.end();) {
+        if (it->nodeId == change.subtree.nodeId) {
+          undo.push_front(NodeTreeChange(NodeTreeChange::ADD, change.parentId,
+                                         std::move(*it)));
+          it = parent->subs.erase(it);
+          found = true;
+        } else {
+          ++it;
+        }
+      }
+    }
+    if (!found) {
+      revert(tree, std::move(undo));
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * A change in the topology of the mesh, see topologyEvents()
+ */
+class TopologyEvent {
+ public:
+  enum Type {
+    JOINED = 0,   ///< nodeId is new in the mesh
+    LEFT = 1,     ///< nodeId (and the nodes behind it) left the mesh
+    MOVED = 2,    ///< nodeId (and the nodes behind it) has a new parent
+    ROOT_CHANGED = 3  ///< nodeId is the new root of the mesh (0 if none)
+  };
+
+  uint8_t type = JOINED;
+  uint32_t nodeId = 0;
+  /**
+   * The route from this node to nodeId, both included
+   *
+   * For LEFT this is the route the node used to be reachable by.
+   */
+  std::vector<uint32_t> path;
+
+  TopologyEvent() {}
+  TopologyEvent(uint8_t type, uint32_t nodeId, std::vector<uint32_t> path)
+      : type(type), nodeId(nodeId), path(std::move(path)) {}
+};
+
+inline void parentMap(const protocol::NodeTree& tree,
+                      std::map<uint32_t, uint32_t>& parents, uint32_t& rootId,
+                      uint32_t parentId = 0) {
+  parents[tree.nodeId] = parentId;
+  if (tree.root) rootId = tree.nodeId;
+  for (auto&& s : tree.subs) parentMap(s, parents, rootId, tree.nodeId);
+}
+
+inline std::vector<uint32_t> pathFromParents(
+    const std::map<uint32_t, uint32_t>& parents, uint32_t nodeId) {
+  std::vector<uint32_t> path;
+  auto it = parents.find(nodeId);
+  while (it != parents.end()) {
+    path.push_back(it->first);
+    if (it->second == 0) break;
+    it = parents.find(it->second);
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+/**
+ * The events that turn one layout into another
+ *
+ * Nodes that left are reported first, then nodes that moved, that joined and
+ * finally whether the root changed. Only the top of a subtree that moved is
+ * reported, the nodes behind it keep their parent.
+ */
+inline std::list<TopologyEvent> topologyEvents(const protocol::NodeTree& from,
+                                               const protocol::NodeTree& to) {
+  std::list<TopologyEvent> events;
+  std::map<uint32_t, uint32_t> fromParents;
+  std::map<uint32_t, uint32_t> toParents;
+  uint32_t fromRoot = 0;
+  uint32_t toRoot = 0;
+  parentMap(from, fromParents, fromRoot);
+  parentMap(to, toParents, toRoot);
+
+  for (auto&& pair : fromParents) {
+    if (toParents.count(pair.first) == 0)
+      events.push_back(TopologyEvent(TopologyEvent::LEFT, pair.first,
+                                     pathFromParents(fromParents, pair.first)));
+  }
+  std::list<TopologyEvent> joined;
+  for (auto&& pair : toParents) {
+    auto it = fromParents.find(pair.first);
+    if (it == fromParents.end())
+      joined.push_back(TopologyEvent(TopologyEvent::JOINED, pair.first,
+                                     pathFromParents(toParents, pair.first)));
+    else if (it->second != pair.second)
+      events.push_back(TopologyEvent(TopologyEvent::MOVED, pair.first,
+                                     pathFromParents(toParents, pair.first)));
+  }
+  events.splice(events.end(), joined);
+  if (fromRoot != toRoot)
+    events.push_back(TopologyEvent(TopologyEvent::ROOT_CHANGED, toRoot,
+                                   pathFromParents(toParents, toRoot)));
+  return events;
+}
+
+/**
+ * Call fn(nodeId) for every node in the tree (in preorder)
+ */
+template <class Fn>
+void forEachNode(const protocol::NodeTree& nodeTree, Fn&& fn) {
+  fn(nodeTree.nodeId);
+  for (auto&& s : nodeTree.subs) forEachNode(s, fn);
 }
 
 template <class T>
@@ -44,20 +385,251 @@ class Layout {
    * On the ESP hardware nodeId is uniquely calculated from the MAC address of
    * the node.
    */
-  uint32_t getNodeId() { return nodeId; }
+  uint32_t getNodeId() const { return nodeId; }
+
+  /// Incremented every time the layout changes, see bumpVersion()
+  uint32_t version = 0;
 
-  protocol::NodeTree asNodeTree() {
-    auto nt = protocol::NodeTree(nodeId, root);
+  /**
+   * The current layout as a NodeTree
+   *
+   * The tree is cached and only rebuild if the layout changed (see version)
+   * since the last call, so repeated calls are cheap. The returned tree is
+   * shared and should not be changed, use asNodeTree() for a copy that can be.
+   */
+  std::shared_ptr<const protocol::NodeTree> nodeTreeSnapshot() {
+    if (!snapshot || snapshotVersion != version) {
+      auto nt = std::make_shared<protocol::NodeTree>(nodeId, root);
+      for (auto&& s : subs) {
+        if (s->nodeId == 0) continue;
+        nt->subs.push_back(protocol::NodeTree(*s));
+      }
+      snapshot = nt;
+      snapshotVersion = version;
+    }
+    return snapshot;
+  }
+
+  protocol::NodeTree asNodeTree() { return *nodeTreeSnapshot(); }
+
+  /**
+   * Mark the layout as changed
+   *
+   * Call this whenever a neighbour adopts a new tree, a connection is closed or
+   * the nodeId or root of this node change.
+   */
+  void bumpVersion() { ++version; }
+
+  /**
+   * The layout as a FlatNodeTree, which is allocated in one go
+   */
+  protocol::FlatNodeTree asFlatNodeTree() {
+    auto nt = protocol::FlatNodeTree(nodeId, root);
     for (auto&& s : subs) {
       if (s->nodeId == 0) continue;
-      nt.subs.push_back(protocol::NodeTree(*s));
+      nt.append(static_cast<const protocol::NodeTree&>(*s));
     }
     return nt;
   }
 
+  /*
+   * The functions below use the aggregates cached by each neighbour (see
+   * Neighbour::updateAggregates), so they only loop over the neighbours and
+   * never touch the rest of the mesh.
+   */
+
+  /**
+   * The number of nodes in the mesh (including this node)
+   */
+  uint32_t size() const {
+    uint32_t no = 1;
+    for (auto&& s : subs) {
+      if (s->nodeId != 0) no += s->subtreeSize;
+    }
+    return no;
+  }
+
+  /**
+   * Whether any node in the mesh is the root of the mesh
+   */
+  bool isRooted() const {
+    if (root) return true;
+    for (auto&& s : subs) {
+      if (s->nodeId != 0 && s->containsRoot) return true;
+    }
+    return false;
+  }
+
+  /**
+   * The number of hops to the root of the mesh (0 if this node is the root)
+   *
+   * \return -1 if the mesh does not contain a root
+   */
+  int rootHops() const {
+    if (root) return 0;
+    int hops = -1;
+    for (auto&& s : subs) {
+      if (s->nodeId == 0 || !s->containsRoot) continue;
+      if (hops < 0 || s->rootHops + 1 < hops) hops = s->rootHops + 1;
+    }
+    return hops;
+  }
+
+  /**
+   * The number of nodes in the mesh
+   *
+   * \param includeSelf Whether to count this node
+   */
+  uint32_t nodeCount(bool includeSelf = true) const {
+    return includeSelf ? size() : size() - 1;
+  }
+
+  /**
+   * Call fn(nodeId) for every node in the current layout
+   *
+   * Walks the subtrees of the neighbours directly, so nothing is copied or
+   * allocated. Neighbours we have not synced with yet are skipped.
+   *
+   * \param includeSelf Whether to also call fn for this node
+   */
+  template <class Fn>
+  void forEachNode(Fn&& fn, bool includeSelf = true) const {
+    if (includeSelf) fn(nodeId);
+    for (auto&& s : subs) {
+      if (s->nodeId == 0) continue;
+      layout::forEachNode(static_cast<const protocol::NodeTree&>(*s), fn);
+    }
+  }
+
+  /**
+   * Copy the nodeIds in the current layout into ids
+   *
+   * At most len ids are copied.
+   *
+   * \return The number of nodes in the layout, which can be larger than len
+   */
+  size_t copyNodeIds(uint32_t* ids, size_t len,
+                     bool includeSelf = true) const {
+    size_t i = 0;
+    forEachNode(
+        [ids, len, &i](uint32_t id) {
+          if (i < len) ids[i] = id;
+          ++i;
+        },
+        includeSelf);
+    return i;
+  }
+
+  /**
+   * The number of hops to the node furthest away
+   */
+  uint16_t maxDepth() const {
+    uint16_t depth = 0;
+    for (auto&& s : subs) {
+      if (s->nodeId != 0 && s->maxDepth + 1 > depth) depth = s->maxDepth + 1;
+    }
+    return depth;
+  }
+
+  /*
+   * Route queries. These use an index of all the nodes in the mesh, which is
+   * rebuild the first time it is used after the layout changed (see version).
+   * The index does not keep closed connections alive.
+   */
+
+  /**
+   * The number of hops to the node (0 for this node)
+   *
+   * \return -1 if the node is not in the mesh
+   */
+  int hopCount(uint32_t id) const {
+    if (id == nodeId) return 0;
+    auto route = findIndexed(id);
+    if (route == routes.end()) return -1;
+    return route->second.hops;
+  }
+
+  /**
+   * The nodes a message to the given node passes, starting with this node and
+   * ending with the destination
+   *
+   * \return An empty list if the node is not in the mesh
+   */
+  std::vector<uint32_t> pathTo(uint32_t id) const {
+    std::vector<uint32_t> path;
+    if (id != nodeId) {
+      auto route = findIndexed(id);
+      if (route == routes.end()) return path;
+      path.reserve(route->second.hops + 1);
+      while (route != routes.end()) {
+        path.push_back(route->first);
+        route = routes.find(route->second.parent);
+      }
+    }
+    path.push_back(nodeId);
+    std::reverse(path.begin(), path.end());
+    return path;
+  }
+
+  /**
+   * The neighbour a message to the given node is send to
+   */
+  std::shared_ptr<T> nextHop(uint32_t id) const {
+    auto route = findIndexed(id);
+    if (route == routes.end()) return NULL;
+    return route->second.via.lock();
+  }
+
+  /**
+   * The (one way) delay in microseconds of the first hop on the route to the
+   * given node, as measured during the last time sync with that neighbour
+   *
+   * Only the links to our direct neighbours are measured, the rest of the
+   * route is unknown to this node.
+   *
+   * \return -1 if unknown
+   */
+  int32_t linkDelay(uint32_t id) const {
+    auto via = nextHop(id);
+    if (!via) return -1;
+    return via->linkDelay;
+  }
+
  protected:
   uint32_t nodeId = 0;
   bool root = false;
+
+  struct Route {
+    uint32_t parent;
+    uint16_t hops;
+    std::weak_ptr<T> via;
+  };
+  // Cache, so it can be (re)build by the const queries
+  mutable std::map<uint32_t, Route> routes;
+  mutable uint32_t routesVersion = 0;
+  mutable bool routesBuilt = false;
+
+  typename std::map<uint32_t, Route>::const_iterator findIndexed(
+      uint32_t id) const {
+    if (!routesBuilt || routesVersion != version) {
+      routes.clear();
+      for (auto&& s : subs) {
+        if (s->nodeId != 0) addRoutes(*s, nodeId, 1, s);
+      }
+      routesVersion = version;
+      routesBuilt = true;
+    }
+    return routes.find(id);
+  }
+
+  void addRoutes(const protocol::NodeTree& tree, uint32_t parent,
+                 uint16_t hops, const std::shared_ptr<T>& via) const {
+    routes.insert(std::make_pair(tree.nodeId, Route{parent, hops, via}));
+    for (auto&& s : tree.subs) addRoutes(s, tree.nodeId, hops + 1, via);
+  }
+
+  std::shared_ptr<const protocol::NodeTree> snapshot;
+  uint32_t snapshotVersion = 0;
 };
 
 template <class T>
@@ -73,25 +645,103 @@ void syncLayout(Layout<T>& layout, uint32_t changedId) {
   layout.stability /= 2;
 }
 
+/**
+ * Set of nodeIds
+ *
+ * Uses open addressing in a single array, so filling it with the nodes of a
+ * tree is one allocation if the expected size is right. It grows when more
+ * nodeIds are inserted. nodeId 0 can not be stored.
+ */
+class NodeIdSet {
+ public:
+  /**
+   * \param capacity The expected number of nodeIds that will be inserted
+   */
+  explicit NodeIdSet(size_t capacity) {
+    size_t buckets = 4;
+    while (buckets < 2 * capacity) buckets *= 2;
+    ids.assign(buckets, 0);
+  }
+
+  /**
+   * Add the nodeId to the set
+   *
+   * \return false if it already was in the set
+   */
+  bool insert(uint32_t id) {
+    if (2 * (count + 1) > ids.size()) grow();
+    if (!place(ids, id)) return false;
+    ++count;
+    return true;
+  }
+
+  size_t size() const { return count; }
+
+ protected:
+  std::vector<uint32_t> ids;
+  size_t count = 0;
+
+  // Keep the load at most one half, so probe sequences stay short
+  void grow() {
+    std::vector<uint32_t> larger(2 * ids.size(), 0);
+    for (auto&& id : ids)
+      if (id != 0) place(larger, id);
+    ids.swap(larger);
+  }
+
+  static bool place(std::vector<uint32_t>& buckets, uint32_t id) {
+    auto mask = buckets.size() - 1;
+    auto i = (id * 2654435769u) & mask;  // Fibonacci hashing
+    while (buckets[i] != 0) {
+      if (buckets[i] == id) return false;
+      i = (i + 1) & mask;
+    }
+    buckets[i] = id;
+    return true;
+  }
+};
+
 class Neighbour : public protocol::NodeTree {
  public:
   // Inherit constructors
   using protocol::NodeTree::NodeTree;
 
+  /// Version of the last NodeSync send to this neighbour (0 if none yet)
+  uint16_t sentVersion = 0;
+  /// Version of the last NodeSync received from this neighbour (0 if none yet)
+  uint16_t receivedVersion = 0;
+  /// Whether the neighbour understands NodeSyncDelta packages
+  bool supportsDelta = false;
+  /**
+   * Our layout as it was when we last send it to this neighbour, the base for
+   * the next delta. This is the complete layout (including the route to this
+   * neighbour), so it can be shared with the layout snapshot.
+   */
+  std::shared_ptr<const protocol::NodeTree> sentLayout;
+
+  /// Number of nodes in the subtree of this neighbour (0 if not synced yet)
+  uint32_t subtreeSize = 0;
+  /// Number of hops from this neighbour to the node furthest away in its subtree
+  uint16_t maxDepth = 0;
+  /// Whether the subtree of this neighbour contains the root of the mesh
+  bool containsRoot = false;
+  /// Number of hops from this neighbour to the root (if containsRoot)
+  uint16_t rootHops = 0;
+  /// One way delay of the link to this neighbour in microseconds (-1 unknown)
+  int32_t linkDelay = -1;
+
   /**
    * Is the passed nodesync valid
    *
    * If not then the caller of this function should probably disconnect
    * this neighbour.
    */
-  bool validSubs(protocol::NodeTree &tree) {
-    if (nodeId == 0)  // Cant really know, so valid as far as we know
-      return true;
-    if (nodeId != tree.nodeId) return false;
-    for (auto&& s : tree.subs) {
-      if (layout::contains(s, nodeId)) return false;
-    }
-    return true;
+  bool validSubs(const protocol::NodeTree& tree) {
+    // Cant really know whether it is us, so only check for duplicates then
+    if (nodeId != 0 && nodeId != tree.nodeId) return false;
+    // The previous size of the subtree is a good guess, the set grows if not
+    NodeIdSet visited(subtreeSize);
+    return uniqueIds(tree, visited);
   }
 
   /**
@@ -107,36 +757,173 @@ class Neighbour : public protocol::NodeTree {
   bool updateSubs(protocol::NodeTree tree) {
     if (nodeId == 0 || tree != (*this)) {
       nodeId = tree.nodeId;
-      subs = tree.subs;
+      subs = std::move(tree.subs);
       root = tree.root;
+      updateAggregates();
       return true;
     }
     return false;
   }
 
+  /**
+   * Recalculate the cached aggregates (subtreeSize, maxDepth, containsRoot and
+   * rootHops) from the current subs
+   *
+   * This is done by updateSubs, so only needed when changing the subs directly.
+   */
+  void updateAggregates() {
+    subtreeSize = 0;
+    maxDepth = 0;
+    containsRoot = false;
+    rootHops = 0;
+    if (nodeId == 0) return;
+    aggregate(*this, 0);
+  }
+
   /**
    * Create a request
+   *
+   * \param layout Our current layout (see Layout::nodeTreeSnapshot()). Only
+   * the part of it that is send is copied.
    */
+  protocol::NodeSyncRequest request(
+      std::shared_ptr<const protocol::NodeTree> layout) {
+    auto subTree = excludeRoute(*layout, nodeId);
+    sent(std::move(layout), 1);
+    auto pkg = protocol::NodeSyncRequest(subTree.nodeId, nodeId,
+                                         std::move(subTree.subs), subTree.root);
+    pkg.features = protocol::FEATURE_NODE_SYNC_DELTA;
+    return pkg;
+  }
+
   protocol::NodeSyncRequest request(NodeTree&& layout) {
-    auto subTree = excludeRoute(std::move(layout), nodeId);
-    return protocol::NodeSyncRequest(subTree.nodeId, nodeId, subTree.subs,
-                                     subTree.root);
+    return request(std::make_shared<const NodeTree>(std::move(layout)));
   }
 
   /**
    * Create a reply
    */
+  protocol::NodeSyncReply reply(
+      std::shared_ptr<const protocol::NodeTree> layout) {
+    auto subTree = excludeRoute(*layout, nodeId);
+    sent(std::move(layout), 1);
+    auto pkg = protocol::NodeSyncReply(subTree.nodeId, nodeId,
+                                       std::move(subTree.subs), subTree.root);
+    pkg.features = protocol::FEATURE_NODE_SYNC_DELTA;
+    return pkg;
+  }
+
   protocol::NodeSyncReply reply(NodeTree&& layout) {
-    auto subTree = excludeRoute(std::move(layout), nodeId);
-    return protocol::NodeSyncReply(subTree.nodeId, nodeId, subTree.subs,
-                                   subTree.root);
+    return reply(std::make_shared<const NodeTree>(std::move(layout)));
+  }
+
+  /**
+   * Create a delta holding the changes since the last NodeSync we send
+   *
+   * \param pkg Will hold the changes on success
+   *
+   * \return false if no delta can be made, i.e. the neighbour does not
+   * support deltas, we did not send a full layout to this neighbour yet, or
+   * our own node changed. A full request() or reply() should be send instead.
+   */
+  bool delta(std::shared_ptr<const protocol::NodeTree> layout,
+             protocol::NodeSyncDelta& pkg, bool reply = false) {
+    if (!supportsDelta || sentVersion == 0 || !sentLayout) return false;
+    if (layout->nodeId != sentLayout->nodeId ||
+        layout->root != sentLayout->root)
+      return false;
+    uint16_t version = sentVersion + 1;
+    if (version == 0) version = 1;
+    pkg = protocol::NodeSyncDelta(
+        layout->nodeId, nodeId, sentVersion, version,
+        layout::diff(*sentLayout, *layout, nodeId), layout->hash(nodeId), reply);
+    sent(std::move(layout), version);
+    return true;
+  }
+
+  bool delta(NodeTree&& layout, protocol::NodeSyncDelta& pkg,
+             bool reply = false) {
+    return delta(std::make_shared<const NodeTree>(std::move(layout)), pkg,
+                 reply);
+  }
+
+  /**
+   * Apply a received delta to the current tree, in place
+   *
+   * \param changed Set to whether the tree changed
+   *
+   * \return false if the delta is not based on the last version we received,
+   * does not apply cleanly, results in invalid subs or in a tree with a
+   * different hash than the tree of the sender. The tree is then left as it
+   * was and the caller should request a full sync.
+   */
+  bool applyDelta(const protocol::NodeSyncDelta& delta, bool& changed) {
+    changed = false;
+    if (receivedVersion == 0 || delta.baseVersion != receivedVersion)
+      return false;
+    auto before = hash();
+    if (delta.changes.empty()) {
+      if (delta.hash != before) return false;
+      receivedVersion = delta.version;
+      return true;
+    }
+    std::list<protocol::NodeTreeChange> undo;
+    if (!layout::apply(*this, delta.changes, undo)) return false;
+    if (hash() != delta.hash || !validSubs(*this)) {
+      layout::revert(*this, std::move(undo));
+      return false;
+    }
+    receivedVersion = delta.version;
+    changed = hash() != before;
+    if (changed) updateAggregates();
+    return true;
+  }
+
+  void clear() {
+    NodeTree::clear();
+    sentVersion = 0;
+    receivedVersion = 0;
+    supportsDelta = false;
+    sentLayout = NULL;
+    linkDelay = -1;
+    updateAggregates();
+  }
+
+ protected:
+  /**
+   * Whether no nodeId occurs twice in the tree
+   *
+   * The top node is the neighbour itself, so this also catches the nodeId of
+   * the neighbour showing up in its own subs.
+   */
+  static bool uniqueIds(const NodeTree& tree, NodeIdSet& visited) {
+    if (tree.nodeId != 0 && !visited.insert(tree.nodeId)) return false;
+    for (auto&& s : tree.subs) {
+      if (!uniqueIds(s, visited)) return false;
+    }
+    return true;
+  }
+
+  void aggregate(const NodeTree& tree, uint16_t depth) {
+    ++subtreeSize;
+    if (depth > maxDepth) maxDepth = depth;
+    if (tree.root && (!containsRoot || depth < rootHops)) {
+      containsRoot = true;
+      rootHops = depth;
+    }
+    for (auto&& s : tree.subs) aggregate(s, depth + 1);
+  }
+
+  void sent(std::shared_ptr<const NodeTree> layout, uint16_t version) {
+    sentLayout = std::move(layout);
+    sentVersion = version;
   }
 };
 
 /**
  * The size of the mesh (the number of nodes)
  */
-inline uint32_t size(protocol::NodeTree nodeTree) {
+inline uint32_t size(const protocol::NodeTree& nodeTree) {
   auto no = 1;
   for (auto&& s : nodeTree.subs) {
     no += size(s);
@@ -147,7 +934,7 @@ inline uint32_t size(protocol::NodeTree nodeTree) {
 /**
  * Whether the top node in the tree is also the root of the mesh
  */
-inline bool isRoot(protocol::NodeTree nodeTree) {
+inline bool isRoot(const protocol::NodeTree& nodeTree) {
   if (nodeTree.root) return true;
   return false;
 }
@@ -155,7 +942,7 @@ inline bool isRoot(protocol::NodeTree nodeTree) {
 /**
  * Whether any node in the tree is also root of the mesh
  */
-inline bool isRooted(protocol::NodeTree nodeTree) {
+inline bool isRooted(const protocol::NodeTree& nodeTree) {
   if (isRoot(nodeTree)) return true;
   for (auto&& s : nodeTree.subs) {
     if (isRooted(s)) return true;
@@ -166,16 +953,60 @@ inline bool isRooted(protocol::NodeTree nodeTree) {
 /**
  * Return all nodes in a list container
  */
-inline std::list<uint32_t> asList(protocol::NodeTree nodeTree,
+inline std::list<uint32_t> asList(const protocol::NodeTree& nodeTree,
                                   bool includeSelf = true) {
   std::list<uint32_t> lst;
   if (includeSelf) lst.push_back(nodeTree.nodeId);
   for (auto&& s : nodeTree.subs) {
-    lst.splice(lst.end(), asList(s));
+    forEachNode(s, [&lst](uint32_t id) { lst.push_back(id); });
   }
   return lst;
 }
 
+/*
+ * Layout versions of the above, these use the cached neighbour aggregates
+ */
+template <class T>
+inline uint32_t size(const Layout<T>& layout) {
+  return layout.size();
+}
+
+template <class T>
+inline bool isRooted(const Layout<T>& layout) {
+  return layout.isRooted();
+}
+
+/*
+ * FlatNodeTree versions of the above, these are all linear scans over the
+ * nodes and do not copy the tree
+ */
+inline bool contains(const protocol::FlatNodeTree& nodeTree, uint32_t nodeId) {
+  return nodeTree.contains(nodeId);
+}
+
+inline protocol::FlatNodeTree excludeRoute(protocol::FlatNodeTree&& tree,
+                                           uint32_t exclude) {
+  tree.excludeRoute(exclude);
+  return std::move(tree);
+}
+
+inline uint32_t size(const protocol::FlatNodeTree& nodeTree) {
+  return nodeTree.size();
+}
+
+inline bool isRoot(const protocol::FlatNodeTree& nodeTree) {
+  return nodeTree.root();
+}
+
+inline bool isRooted(const protocol::FlatNodeTree& nodeTree) {
+  return nodeTree.isRooted();
+}
+
+inline std::list<uint32_t> asList(const protocol::FlatNodeTree& nodeTree,
+                                  bool includeSelf = true) {
+  return nodeTree.asList(includeSelf);
+}
+
 }  // namespace layout
 }  // namespace painlessmesh
 
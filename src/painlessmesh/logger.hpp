@@ -1,5 +1,10 @@
 #ifndef _PAINLESS_MESH_LOGGER_HPP_
 #define _PAINLESS_MESH_LOGGER_HPP_
+
+#ifndef PAINLESSMESH_LOG_MASK
+#define PAINLESSMESH_LOG_MASK 0xFFFF  // Log levels that are compiled in
+#endif
+
 namespace painlessmesh {
 namespace logger {
 
@@ -21,11 +26,22 @@ typedef enum {
   DEBUG = 1 << 11
 } LogLevel;
 
+/**
+ * Whether log messages of the given type are compiled in
+ *
+ * Messages of types that are not in PAINLESSMESH_LOG_MASK are left out of the
+ * build, including the evaluation of their arguments. E.g. build with
+ * -DPAINLESSMESH_LOG_MASK=0x3 to keep only the ERROR and STARTUP messages.
+ */
+constexpr bool enabled(uint16_t type) {
+  return (type & (PAINLESSMESH_LOG_MASK)) != 0;
+}
+
 class LogClass {
  public:
   void setLogLevel(uint16_t newTypes) {
     // set the different kinds of debug messages you want to generate.
-    types = newTypes;
+    types = newTypes & (PAINLESSMESH_LOG_MASK);
     Serial.print(F("\nsetLogLevel:"));
     if (types & ERROR) {
       Serial.print(F(" ERROR |"));
@@ -66,6 +82,12 @@ class LogClass {
     Serial.println();
     return;
   }
+
+  /**
+   * Whether messages of this type are currently printed
+   */
+  bool isEnabled(uint16_t type) const { return (type & types) != 0; }
+
   void operator()(LogLevel type, const char* format...) {
     if (type & types) {  // Print only the message types set for output
       va_list args;
@@ -127,5 +149,17 @@ class LogClass {
 
 }  // namespace logger
 }  // namespace painlessmesh
+
+/**
+ * Log(type, format, ...) only evaluates its arguments when the type is
+ * compiled in (see PAINLESSMESH_LOG_MASK) and currently enabled with
+ * setLogLevel(). For types that are not compiled in the whole call is
+ * removed by the compiler.
+ */
+#define Log(type, ...)                                                   \
+  do {                                                                   \
+    if (painlessmesh::logger::enabled(type) && (Log).isEnabled(type))    \
+      (Log)(type, __VA_ARGS__);                                          \
+  } while (0)
 #endif
 
@@ -7,7 +7,10 @@
 #include "painlessmesh/packageTypeProvider.hpp"
 #include "painlessmesh/plugin.hpp"
 #include "painlessmesh/protocol.hpp"
+#include "painlessmesh/reactor.hpp"
+#include "painlessmesh/request.hpp"
 #include "painlessmesh/tcp.hpp"
+#include "painlessmesh/timer.hpp"
 // #include "GDBStub.h"
 
 #ifdef PAINLESSMESH_ENABLE_OTA
@@ -21,6 +24,14 @@ typedef std::function<void(uint32_t from, std::string &msg)> receivedCallback_t;
 typedef std::function<void()> changedConnectionsCallback_t;
 typedef std::function<void(int32_t offset)> nodeTimeAdjustedCallback_t;
 typedef std::function<void(uint32_t nodeId, int32_t delay)> nodeDelayCallback_t;
+typedef std::function<void(const layout::TopologyEvent &event)>
+    topologyEventCallback_t;
+typedef std::function<void(uint32_t nodeId,
+                           const protocol::time_sync_report_t &report)>
+    timeSyncReportCallback_t;
+typedef std::function<void(uint32_t from, std::string &msg,
+                           std::function<void(std::string reply)> respond)>
+    requestCallback_t;
 
 /**
  * Main api class for the mesh
@@ -32,18 +43,30 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
  public:
   void init(uint32_t id) {
     /* NONE = 0,
+      BROADCAST_AT = 1,
+      TIME_BEACON = 2,
       TIME_DELAY = 3,
       TIME_SYNC = 4,
       NODE_SYNC_REQUEST = 5,
       NODE_SYNC_REPLY = 6,
+      NODE_SYNC_DELTA = 7,
       BROADCAST = 8,  // application data for everyone
-      SINGLE = 9      // application data for a single node,*/
+      SINGLE = 9      // application data for a single node,
+      TIME_SYNC_REPORT = 14,
+      REQUEST = 15,
+      RESPONSE = 16*/
+    PackageTypeProvider::add<protocol::Response>(16);
+    PackageTypeProvider::add<protocol::Request>(15);
+    PackageTypeProvider::add<protocol::TimeSyncReport>(14);
     PackageTypeProvider::add<protocol::Single>(9);
     PackageTypeProvider::add<protocol::Broadcast>(8);
+    PackageTypeProvider::add<protocol::NodeSyncDelta>(7);
     PackageTypeProvider::add<protocol::NodeSyncReply>(6);
     PackageTypeProvider::add<protocol::NodeSyncRequest>(5);
     PackageTypeProvider::add<protocol::TimeSync>(4);
     PackageTypeProvider::add<protocol::TimeDelay>(3);
+    PackageTypeProvider::add<protocol::TimeBeacon>(2);
+    PackageTypeProvider::add<protocol::BroadcastAt>(1);
     // PackageTypeProvider::add<plugin::An>(10);
     // PackageTypeProvider::add<plugin::SinglePackage>(3);
 
@@ -53,22 +76,35 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
     }
 
     this->nodeId = id;
+    this->bumpVersion();
 
 #ifdef ESP32
     xSemaphore = xSemaphoreCreateMutex();
 #endif
 
     mScheduler->enableAll();
+    reactor.init(*mScheduler);
+    timers.init(*mScheduler);
+    requests.init(timers);
+    delayRequests.init(timers);
 
     // Add package handlers
     this->callbackList = painlessmesh::ntp::addPackageCallback(
         std::move(this->callbackList), (*this));
     this->callbackList = painlessmesh::router::addPackageCallback(
         std::move(this->callbackList), (*this));
+    this->callbackList.onPackage(
+        protocol::RESPONSE,
+        [this](VariantBase *variant, std::shared_ptr<T>, uint32_t) {
+          auto pkg = static_cast<Variant<protocol::Response> *>(variant);
+          this->requests.complete(pkg->package->id, pkg->package->msg);
+          return true;
+        });
 
     this->changedConnectionCallbacks.push_back([this](uint32_t nodeId) {
       Log(MESH_STATUS, "Changed connections in neighbour %u\n", nodeId);
       if (nodeId != 0) layout::syncLayout<T>((*this), nodeId);
+      this->emitTopologyEvents();
     });
     this->droppedConnectionCallbacks.push_back([this](uint32_t nodeId,
                                                       bool station) {
@@ -78,6 +114,13 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
     this->newConnectionCallbacks.push_back([this](uint32_t nodeId) {
       Log(MESH_STATUS, "New connection %u\n", nodeId);
     });
+
+    // Read the time regularly, so the 64 bit time notices micros() rolling over
+    // and a stale time beacon is forgotten before it does
+    this->addTask(10 * TASK_MINUTE, TASK_FOREVER, [this]() {
+      this->getNodeTime64();
+      this->beaconLocked(micros());
+    });
   }
 
   void init(Scheduler *scheduler, uint32_t id) {
@@ -138,7 +181,10 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
    * If one node is root, then it is also recommended to call
    * painlessMesh::setContainsRoot() on all the nodes in the mesh.
    */
-  void setRoot(bool on = true) { this->root = on; };
+  void setRoot(bool on = true) {
+    this->root = on;
+    this->bumpVersion();
+  };
 
   /**
    * The mesh should contains a root node
@@ -154,6 +200,133 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
    */
   bool isRoot() { return this->root; };
 
+  /**
+   * Let the root distribute the mesh time with time beacons
+   *
+   * When enabled on the root, it sends a beacon to its neighbours every
+   * TIME_BEACON_INTERVAL. Each node corrects the beacon for the delay of the
+   * link it arrived on and passes it on down the tree. Nodes that follow the
+   * beacons stop the pairwise time sync and only keep measuring the delay of
+   * the link towards the root. When the beacons stop (e.g. the root left) they
+   * fall back to the pairwise time sync.
+   *
+   * Only has an effect on the root, other nodes follow the beacons
+   * automatically.
+   */
+  void setTimeBeacons(bool on = true) {
+    if (on && !timeBeaconTask) {
+      timeBeaconTask =
+          this->addTask(TIME_BEACON_INTERVAL, TASK_FOREVER, [this]() {
+            if (!this->isRoot()) return;
+            ntp::sendTimeBeacons((*this), ++this->beaconSequence, 0);
+          });
+    } else if (!on && timeBeaconTask) {
+      timeBeaconTask->disable();
+      timeBeaconTask = nullptr;
+    }
+  }
+
+  /**
+   * Whether the time is distributed by time beacons, either because we are
+   * the root sending them or because we receive them
+   */
+  bool followsTimeBeacons() {
+    if (this->isRoot()) return timeBeaconTask != nullptr;
+    return this->beaconLocked(micros());
+  }
+
+  /**
+   * The number of hops between this node and the root the mesh time comes
+   * from (0 for the root itself)
+   *
+   * @return -1 if the mesh does not contain a root
+   */
+  int timeStratum() {
+    if (!this->isRoot() && this->beaconLocked(micros()))
+      return this->beaconHops;
+    return this->rootHops();
+  }
+
+  /**
+   * Quality of the time sync with a neighbour
+   *
+   * @return false if nodeId is not a neighbour
+   */
+  bool getTimeSyncStats(uint32_t nodeId, ntp::SyncStats &stats) {
+    for (auto &&conn : this->subs) {
+      if (conn->nodeId == nodeId) {
+        stats = conn->timeSyncStats;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Summary of the quality of the time sync of this node
+   *
+   * The offset and error bound are those of the most recent sync with any of
+   * the neighbours, the number of samples is the total over all neighbours.
+   */
+  protocol::time_sync_report_t getTimeSyncReport() {
+    protocol::time_sync_report_t report;
+    report.stratum = timeStratum();
+    report.drift = this->drift();
+    auto now = micros();
+    for (auto &&conn : this->subs) {
+      auto &&stats = conn->timeSyncStats;
+      report.samples += stats.samples;
+      if (stats.syncs == 0) continue;
+      auto since = stats.sinceSync(now) / 1000;
+      if (since < report.sinceSync) {
+        report.sinceSync = since;
+        report.offset = stats.offset;
+        report.errorBound = stats.errorBound;
+      }
+    }
+    return report;
+  }
+
+  /**
+   * Broadcast a time sync report (see getTimeSyncReport()) every interval
+   *
+   * Other nodes receive them with onTimeSyncReport(), which allows a single
+   * node (e.g. a bridge) to monitor the time sync of the whole mesh.
+   *
+   * @param interval Time between reports (e.g. TASK_MINUTE), 0 to stop
+   */
+  void setTimeSyncReports(unsigned long interval) {
+    if (timeSyncReportTask) {
+      timeSyncReportTask->disable();
+      timeSyncReportTask = nullptr;
+    }
+    if (interval == 0) return;
+    timeSyncReportTask = this->addTask(interval, TASK_FOREVER, [this]() {
+      auto pkg = protocol::TimeSyncReport(this->nodeId);
+      pkg.msg = this->getTimeSyncReport();
+      router::broadcast<protocol::TimeSyncReport, T>(pkg, (*this), 0);
+    });
+  }
+
+  /**
+   * Callback that gets called when a time sync report of another node arrives
+   *
+   * \code
+   * mesh.onTimeSyncReport([](auto nodeId, auto report) {
+   *   if (report.errorBound > 10000) Serial.printf("%u is off\n", nodeId);
+   * });
+   * \endcode
+   */
+  void onTimeSyncReport(timeSyncReportCallback_t onReport) {
+    this->callbackList.onPackage(
+        protocol::TIME_SYNC_REPORT,
+        [onReport](VariantBase *variant, std::shared_ptr<T>, uint32_t) {
+          auto pkg = static_cast<Variant<protocol::TimeSyncReport> *>(variant);
+          onReport(pkg->package->from, pkg->package->msg);
+          return false;
+        });
+  }
+
   void setDebugMsgTypes(uint16_t types) { Log.setLogLevel(types); }
 
   /**
@@ -167,6 +340,12 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
       (*conn)->close();
       this->eraseClosedConnections();
     }
+    timeBeaconTask = nullptr;
+    timeSyncReportTask = nullptr;
+    requests.stop();
+    delayRequests.stop();
+    reactor.stop();
+    timers.stop();
     plugin::PackageHandler<T>::stop();
   }
 
@@ -178,6 +357,7 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
   void update(void) {
     if (semaphoreTake()) {
       mScheduler->execute();
+      this->releaseTasks();
       semaphoreGive();
 
     }
@@ -220,6 +400,138 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
     return false;
   }
 
+  /** Broadcast a message that is delivered at the given mesh time
+   *
+   * Every node calls its onReceive() callback for the message at meshTime, so
+   * they act at the same moment (within the accuracy of the time sync)
+   * regardless of how many hops away they are. See scheduleAt() for the
+   * limits on meshTime.
+   *
+   * @param includeSelf Deliver the message to myself as well. Default is false.
+   *
+   * @return true if everything works, false if not
+   */
+  bool sendBroadcastAt(uint64_t meshTime, TSTRING msg,
+                       bool includeSelf = false) {
+    using namespace logger;
+    Log(COMMUNICATION, "sendBroadcastAt(): msg length=%zu\n", msg.size());
+    auto pkg =
+        painlessmesh::protocol::BroadcastAt(this->nodeId, meshTime, msg);
+    auto success =
+        router::broadcast<protocol::BroadcastAt, T>(pkg, (*this), 0);
+    if (success && includeSelf) {
+      auto variant = Variant<painlessmesh::protocol::BroadcastAt>(&pkg);
+      this->callbackList.execute(
+          pkg.header.type, static_cast<VariantBase *>(&variant), nullptr, 0);
+    }
+    if (success > 0) return true;
+    return false;
+  }
+
+  /** Call the callback at the given mesh time
+   *
+   * All nodes share the mesh time, so this can be used to let nodes act at
+   * the same moment. Changes to the mesh time while waiting are taken into
+   * account. The time should be less than 35 minutes away (use
+   * getNodeTime64() as the base), times in the past fire as soon as possible.
+   *
+   * \code
+   * // Toggle the led in one second
+   * mesh.scheduleAt(mesh.getNodeTime64() + 1000000, []() { toggleLed(); });
+   * \endcode
+   *
+   * @return The task used, disable it to cancel
+   */
+  std::shared_ptr<Task> scheduleAt(uint64_t meshTime,
+                                   std::function<void()> callback) {
+    auto task = this->addTask(TASK_IMMEDIATE, TASK_FOREVER, NULL);
+    std::weak_ptr<Task> weak = task;
+    task->setCallback([this, meshTime, callback, weak]() {
+      auto task = weak.lock();
+      int64_t remaining = meshTime - this->getNodeTime64();
+      if (remaining > 500) {
+        // Wake up a little early when far away, in case the time is adjusted
+        // in the mean time
+        if (remaining > 100000)
+          task->delay((remaining - 50000) / 1000);
+        else
+          task->delay((remaining + 500) / 1000);
+        return;
+      }
+      task->disable();
+      callback();
+    });
+    return task;
+  }
+
+  /** Send a request to a node and wait for its response
+   *
+   * The node answers with the responder passed to its onRequest() callback.
+   * Any number of requests can wait for their response at the same time.
+   *
+   * \code
+   * mesh.sendRequest(nodeId, "temperature")->then([](auto status, auto reply) {
+   *   if (status == request::DONE) Serial.println(reply.c_str());
+   * });
+   * \endcode
+   *
+   * @param timeout Time to wait for the response (ms)
+   * @return The pending response, its status is FAILED if there is no route
+   * to the node
+   */
+  std::shared_ptr<request::Pending<TSTRING>> sendRequest(
+      uint32_t destId, TSTRING msg, unsigned long timeout = REQUEST_TIMEOUT) {
+    Log(logger::COMMUNICATION, "sendRequest(): dest=%u \n", destId);
+    auto id = requests.nextId();
+    auto pending = requests.start(id, timeout);
+    auto pkg = protocol::Request(this->nodeId, destId, id, msg);
+    if (!router::send<protocol::Request, T>(pkg, (*this))) requests.fail(id);
+    return pending;
+  }
+
+  /** Set a callback routine for requests send to this node
+   *
+   * Pass the response to respond(), either straight away or later on.
+   *
+   * \code
+   * mesh.onRequest([](auto from, auto msg, auto respond) {
+   *   if (msg == "temperature") respond(String(readTemperature()).c_str());
+   * });
+   * \endcode
+   */
+  void onRequest(requestCallback_t onRequest) {
+    this->callbackList.onPackage(
+        protocol::REQUEST,
+        [this, onRequest](VariantBase *variant, std::shared_ptr<T>, uint32_t) {
+          auto pkg = static_cast<Variant<protocol::Request> *>(variant);
+          auto from = pkg->package->from;
+          auto id = pkg->package->id;
+          onRequest(from, pkg->package->msg, [this, from, id](TSTRING reply) {
+            auto response = protocol::Response(this->nodeId, from, id, reply);
+            router::send<protocol::Response, T>(response, (*this));
+          });
+          return false;
+        });
+  }
+
+  /** Measure the trip delay to a node
+   *
+   * Like startDelayMeas(), but the delay is returned in the pending result
+   * instead of passed to the onNodeDelayReceived() callback.
+   *
+   * @param timeout Time to wait for the answer (ms)
+   */
+  std::shared_ptr<request::Pending<int32_t>> requestDelay(
+      uint32_t nodeId, unsigned long timeout = REQUEST_TIMEOUT) {
+    // The answer echoes our time stamp, which tells it apart from the answers
+    // to other delay measurements of the same node
+    auto t0 = this->getNodeTime();
+    auto key = std::make_pair(nodeId, t0);
+    auto pending = delayRequests.start(key, timeout);
+    if (!sendDelayRequest(nodeId, t0)) delayRequests.fail(key);
+    return pending;
+  }
+
   /** Sends a node a packet to measure network trip delay to that node.
    *
    * After calling this function, user program have to wait to the response in
@@ -228,12 +540,7 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
    * @return true if nodeId is connected to the mesh, false otherwise
    */
   bool startDelayMeas(uint32_t id) {
-    using namespace logger;
-    Log(S_TIME, "startDelayMeas(): NodeId %u\n", id);
-    auto conn = painlessmesh::router::findRoute<T>((*this), id);
-    if (!conn) return false;
-    return router::send<protocol::TimeDelay, T>(
-        protocol::TimeDelay(this->nodeId, id, this->getNodeTime()), conn);
+    return sendDelayRequest(id, this->getNodeTime());
   }
 
   /** Set a callback routine for any messages that are addressed to this node.
@@ -266,6 +573,18 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
           onReceive(pkg->package->from, pkg->package->msg);
           return false;
         });
+    this->callbackList.onPackage(
+        protocol::BROADCAST_AT,
+        [this, onReceive](VariantBase *variant, std::shared_ptr<T>, uint32_t) {
+          auto pkg = static_cast<Variant<protocol::BroadcastAt> *>(variant);
+          auto from = pkg->package->from;
+          auto msg = pkg->package->msg;
+          this->scheduleAt(this->expandTime(pkg->package->time),
+                           [onReceive, from, msg]() mutable {
+                             onReceive(from, msg);
+                           });
+          return false;
+        });
   }
 
   /** Callback that gets called every time the local node makes a new
@@ -317,6 +636,25 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
         });
   }
 
+  /** Callback that gets called for every change in the layout of the mesh
+   *
+   * Unlike onChangedConnections this reports exactly which nodes joined, left
+   * or moved and whether the root changed, including the route to the node.
+   *
+   * \code
+   * mesh.onTopologyEvent([](auto event) {
+   *    if (event.type == layout::TopologyEvent::JOINED)
+   *      Serial.println(String(event.nodeId));
+   * });
+   * \endcode
+   */
+  void onTopologyEvent(topologyEventCallback_t onTopologyEvent) {
+    Log(logger::GENERAL, "onTopologyEvent():\n");
+    if (topologyEventCallbacks.size() == 0)
+      lastTopology = this->nodeTreeSnapshot();
+    topologyEventCallbacks.push_back(onTopologyEvent);
+  }
+
   /** Callback that gets called every time node time gets adjusted
    *
    * Node time is automatically kept in sync in the mesh. This gets called
@@ -364,17 +702,40 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
   /** Get a list of all known nodes.
    *
    * This includes nodes that are both directly and indirectly connected to the
-   * current node.
+   * current node. Use forEachNode(), nodeCount() or copyNodeIds() to go over
+   * the nodes without allocating a list.
    */
   std::list<uint32_t> getNodeList(bool includeSelf = false) {
-    return painlessmesh::layout::asList(this->asNodeTree(), includeSelf);
+    std::list<uint32_t> lst;
+    this->forEachNode([&lst](uint32_t id) { lst.push_back(id); },
+                      includeSelf);
+    return lst;
   }
 
   /**
    * Return a json representation of the current mesh layout
    */
   inline TSTRING subConnectionJson(bool pretty = false) {
-    return this->asNodeTree().toString(pretty);
+    return this->nodeTreeSnapshot()->toString(pretty);
+  }
+
+  /**
+   * Write a json representation of the current mesh layout to the sink
+   *
+   * The sink can be any class with a write(const char*, size_t) function, e.g.
+   * exporter::BufferSink to write into a fixed buffer.
+   */
+  template <class Sink>
+  void writeSubConnectionJson(Sink& sink, bool pretty = false) {
+    exporter::writeJson(*this->nodeTreeSnapshot(), sink, pretty);
+  }
+
+  /**
+   * Write a CBOR representation of the current mesh layout to the sink
+   */
+  template <class Sink>
+  void writeSubConnectionCbor(Sink& sink) {
+    exporter::writeCbor(*this->nodeTreeSnapshot(), sink);
   }
 
   inline std::shared_ptr<Task> addTask(unsigned long aInterval,
@@ -404,8 +765,18 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
     using namespace logger;
     Log(S_TIME, "startTimeSync(): from %u with %u\n", this->nodeId,
         conn->nodeId);
+    if (this->followsTimeBeacons()) {
+      // The time arrives with the beacons, only the delay of the link they
+      // arrive on needs to be kept up to date
+      if (!this->isRoot() && conn->nodeId == this->beaconSource) {
+        protocol::TimeDelay timeDelay(this->nodeId, conn->nodeId,
+                                      this->getNodeTime());
+        ntp::sendTimed<protocol::TimeDelay, T>(timeDelay, conn, true);
+      }
+      return;
+    }
     painlessmesh::protocol::TimeSync timeSync;
-    if (ntp::adopt(this->asNodeTree(), (*conn))) {
+    if (ntp::adopt(*this, (*conn))) {
       timeSync = painlessmesh::protocol::TimeSync(this->nodeId, conn->nodeId,
                                                   this->getNodeTime());
       Log(S_TIME, "startTimeSync(): Requesting time from %u\n", conn->nodeId);
@@ -414,7 +785,7 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
       Log(S_TIME, "startTimeSync(): Requesting %u to adopt our time\n",
           conn->nodeId);
     }
-    router::send<protocol::TimeSync, T>(timeSync, conn, true);
+    ntp::sendTimed<protocol::TimeSync, T>(timeSync, conn, true);
   }
 
   bool closeConnectionSTA() {
@@ -430,6 +801,22 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
     return false;
   }
 
+  /**
+   * Compare the current layout with the layout at the previous call and emit
+   * the differences to the topology event callbacks
+   */
+  void emitTopologyEvents() {
+    if (topologyEventCallbacks.size() == 0) return;
+    auto current = this->nodeTreeSnapshot();
+    if (lastTopology == current) return;
+    auto events = lastTopology ? layout::topologyEvents(*lastTopology, *current)
+                               : layout::topologyEvents(
+                                     protocol::NodeTree(this->nodeId, false),
+                                     *current);
+    lastTopology = current;
+    for (auto &&event : events) topologyEventCallbacks.execute(event);
+  }
+
   void eraseClosedConnections() {
     using namespace logger;
     Log(CONNECTION, "eraseClosedConnections():\n");
@@ -441,8 +828,12 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
   callback::List<uint32_t> newConnectionCallbacks;
   callback::List<uint32_t, bool> droppedConnectionCallbacks;
   callback::List<uint32_t> changedConnectionCallbacks;
+  callback::List<const layout::TopologyEvent &> topologyEventCallbacks;
+  std::shared_ptr<const protocol::NodeTree> lastTopology;
   nodeTimeAdjustedCallback_t nodeTimeAdjustedCallback;
   nodeDelayCallback_t nodeDelayReceivedCallback;
+  std::shared_ptr<Task> timeBeaconTask;
+  std::shared_ptr<Task> timeSyncReportTask;
 #ifdef ESP32
   SemaphoreHandle_t xSemaphore = NULL;
 #endif
@@ -454,6 +845,25 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
 
   Scheduler *mScheduler;
 
+  /// Reads and writes the data of all connections
+  tcp::Reactor<T> reactor;
+  /// Runs the internal timers, e.g. those of the connections
+  timer::Wheel timers;
+  /// Requests waiting for a response, by correlation id
+  request::Tracker<TSTRING> requests;
+  /// Delay measurements waiting for an answer, by node and time stamp of the
+  /// request
+  request::Tracker<int32_t, std::pair<uint32_t, uint32_t>> delayRequests;
+
+  bool sendDelayRequest(uint32_t id, uint32_t t0) {
+    using namespace logger;
+    Log(S_TIME, "sendDelayRequest(): NodeId %u\n", id);
+    auto conn = painlessmesh::router::findRoute<T>((*this), id);
+    if (!conn) return false;
+    auto timeDelay = protocol::TimeDelay(this->nodeId, id, t0);
+    return router::send<protocol::TimeDelay, T>(timeDelay, conn);
+  }
+
   /**
    * Wrapper function for ESP32 semaphore function
    *
@@ -489,8 +899,13 @@ class Mesh : public ntp::MeshTime, public plugin::PackageHandler<T> {
   friend void painlessmesh::ntp::handleTimeDelay<Mesh, T>(
       Mesh &, painlessmesh::protocol::TimeDelay *, std::shared_ptr<T>,
       uint32_t);
+  friend void painlessmesh::ntp::handleTimeBeacon<Mesh, T>(
+      Mesh &, painlessmesh::protocol::TimeBeacon *, std::shared_ptr<T>,
+      uint32_t);
   friend void painlessmesh::router::handleNodeSync<Mesh, T>(
       Mesh &, protocol::NodeTree *, std::shared_ptr<T> conn);
+  friend void painlessmesh::router::nodeSyncDone<Mesh, T>(
+      Mesh &, std::shared_ptr<T>, bool);
   friend void painlessmesh::tcp::initServer<T, Mesh>(AsyncServer &, Mesh &);
   friend void painlessmesh::tcp::connect<T, Mesh>(AsyncClient &, IPAddress,
                                                   uint16_t, Mesh &);
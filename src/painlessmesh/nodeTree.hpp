@@ -2,18 +2,152 @@
 #define _PAINLESS_MESH_NODETREE_HPP_
 
 #include <list>
-#include <sstream>
 #include <string>
+#include <utility>
+
+#include "painlessmesh/exporter.hpp"
 
 namespace painlessmesh {
 namespace protocol  // save renaming
 {
 
+/**
+ * The subs of a NodeTree
+ *
+ * Behaves like the std::list it wraps, but also caches the combined hash of the
+ * subs (see NodeTree::hash()). Any non-const access drops that cache. A node
+ * deeper in the tree can only be changed through non-const access to the subs
+ * of each of its ancestors, so their caches are dropped as well.
+ */
+template <class T>
+class SubList {
+ public:
+  typedef typename std::list<T>::value_type value_type;
+  typedef typename std::list<T>::size_type size_type;
+  typedef typename std::list<T>::iterator iterator;
+  typedef typename std::list<T>::const_iterator const_iterator;
+
+  SubList() {}
+  SubList(std::list<T> items) : items(std::move(items)) {}
+  SubList(const SubList& other)
+      : items(other.items), sum(other.sum), hashed(other.hashed) {}
+  SubList(SubList&& other)
+      : items(std::move(other.items)), sum(other.sum), hashed(other.hashed) {
+    other.invalidate();
+  }
+
+  SubList& operator=(const SubList& other) {
+    items = other.items;
+    sum = other.sum;
+    hashed = other.hashed;
+    return (*this);
+  }
+
+  SubList& operator=(SubList&& other) {
+    items = std::move(other.items);
+    sum = other.sum;
+    hashed = other.hashed;
+    other.invalidate();
+    return (*this);
+  }
+
+  SubList& operator=(std::list<T> other) {
+    items = std::move(other);
+    invalidate();
+    return (*this);
+  }
+
+  operator std::list<T>() const& { return items; }
+  operator std::list<T>() && {
+    invalidate();
+    return std::move(items);
+  }
+
+  const_iterator begin() const { return items.begin(); }
+  const_iterator end() const { return items.end(); }
+  const_iterator cbegin() const { return items.cbegin(); }
+  const_iterator cend() const { return items.cend(); }
+  iterator begin() {
+    invalidate();
+    return items.begin();
+  }
+  iterator end() {
+    invalidate();
+    return items.end();
+  }
+
+  size_type size() const { return items.size(); }
+  bool empty() const { return items.empty(); }
+
+  const T& front() const { return items.front(); }
+  const T& back() const { return items.back(); }
+  T& front() {
+    invalidate();
+    return items.front();
+  }
+  T& back() {
+    invalidate();
+    return items.back();
+  }
+
+  void push_back(const T& t) {
+    invalidate();
+    items.push_back(t);
+  }
+  void push_back(T&& t) {
+    invalidate();
+    items.push_back(std::move(t));
+  }
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    invalidate();
+    items.emplace_back(std::forward<Args>(args)...);
+  }
+  void pop_back() {
+    invalidate();
+    items.pop_back();
+  }
+  void pop_front() {
+    invalidate();
+    items.pop_front();
+  }
+  iterator erase(const_iterator pos) {
+    invalidate();
+    return items.erase(pos);
+  }
+  template <typename P>
+  void remove_if(P pred) {
+    invalidate();
+    items.remove_if(pred);
+  }
+  void resize(size_type n) {
+    invalidate();
+    items.resize(n);
+  }
+  void reverse() {
+    invalidate();
+    items.reverse();
+  }
+  void clear() {
+    invalidate();
+    items.clear();
+  }
+
+ protected:
+  friend T;
+
+  std::list<T> items;
+  mutable uint64_t sum = 0;
+  mutable bool hashed = false;
+
+  void invalidate() { hashed = false; }
+};
+
 class NodeTree {
  public:
   uint32_t nodeId = 0;
   bool root = false;
-  std::list<NodeTree> subs;
+  SubList<NodeTree> subs;
 
   NodeTree() {}
   NodeTree(uint32_t nodeID, bool iAmRoot) {
@@ -21,33 +155,67 @@ class NodeTree {
     root = iAmRoot;
   }
 
-  bool operator==(const NodeTree& b) const {
-    if (!(this->nodeId == b.nodeId && this->root == b.root &&
-          this->subs.size() == b.subs.size()))
-      return false;
-    auto itA = this->subs.begin();
-    auto itB = b.subs.begin();
-    for (size_t i = 0; i < this->subs.size(); ++i) {
-      if ((*itA) != (*itB)) {
-        return false;
-      }
-      ++itA;
-      ++itB;
+  /**
+   * Hash of this node and all its subs
+   *
+   * The hash of the subs is cached (see SubList), so comparing trees is
+   * normally O(1). Copies of a tree share the cached hashes of all their nodes,
+   * which means that rehashing a tree after a change only needs to visit the
+   * changed nodes and their ancestors. The order of the subs does not matter.
+   *
+   * Keep in mind that a reference to a sub no longer invalidates its ancestors
+   * once their hash has been taken again, so get it again before changing it.
+   */
+  uint64_t hash() const {
+    if (!subs.hashed) {
+      uint64_t subHash = 0;
+      // Sum, so the order of the subs does not matter
+      for (auto&& s : subs) subHash += mix(s.hash());
+      subs.sum = subHash;
+      subs.hashed = true;
     }
-    return true;
+    return combine(subs.sum);
+  }
+
+  /**
+   * The hash this tree would have without the (direct) subs with nodeId
+   * exclude or 0, i.e. the hash of layout::excludeRoute(tree, exclude)
+   */
+  uint64_t hash(uint32_t exclude) const {
+    uint64_t subHash = 0;
+    for (auto&& s : subs) {
+      if (s.nodeId != 0 && s.nodeId != exclude) subHash += mix(s.hash());
+    }
+    return combine(subHash);
+  }
+
+  /**
+   * Trees are equal if they contain the same nodes in the same structure
+   *
+   * Only the (cached) hashes are compared, see hash().
+   */
+  bool operator==(const NodeTree& b) const {
+    return this->nodeId == b.nodeId && this->root == b.root &&
+           this->hash() == b.hash();
   }
 
   bool operator!=(const NodeTree& b) const { return !this->operator==(b); }
 
-  std::string toString(bool pretty = false) {
+  /**
+   * The tree as compact JSON
+   *
+   * pretty is ignored, as it always was, so subConnectionJson() keeps giving
+   * a single line. Use exporter::writeJson() for indented JSON.
+   */
+  std::string toString(bool pretty = false) const {
     /*{"nodeId":1,"subs":[{"nodeId":763956430,"root":true,"subs":[{"nodeId":763955710},{"nodeId":3257231619,"subs":[{"nodeId":3257168800,"subs":[{"nodeId":3257168818,"subs":[{"nodeId":3257232294}]}]}]},{"nodeId":3257233774},{"nodeId":3257144719,"subs":[{"nodeId":3257153413},{"nodeId":3257232527}]}]}]}*/
-    std::stringstream ss;
-    toString(pretty, ss);
-
-    return ss.str();
+    std::string str;
+    exporter::StringSink sink(str);
+    exporter::writeJson(*this, sink);
+    return str;
   }
 
-  uint32_t size() {
+  uint32_t size() const {
     uint32_t size = sizeof(nodeId) + sizeof(root);
     size += sizeof(subs.size());
     for (auto&& i : subs) {
@@ -62,19 +230,43 @@ class NodeTree {
     root = false;
   }
 
- private:
-  void toString(bool pretty, std::stringstream& ss) {
-    ss << "{\"nodeId\":" << nodeId;
-    if (root) ss << ",\"root\":true";
-    if (subs.size() > 0) {
-      ss << ",\"subs\":[";
-      for (auto&& sub : subs) {
-        sub.toString(pretty, ss);
-        if (sub != subs.back()) ss << ",";
-      }
-      ss << "]";
-    }
-    ss << "}";
+ protected:
+  static uint64_t mix(uint64_t h) {
+    // Finalizer of murmurhash3
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  uint64_t combine(uint64_t subHash) const {
+    return mix(mix(nodeId ^ (root ? 0x9e3779b97f4a7c15ULL : 0)) ^ subHash);
+  }
+};
+
+/**
+ * A single change to a NodeTree
+ *
+ * Used to send only the differences between two versions of a layout. ADD
+ * appends subtree to the subs of the node with parentId, REMOVE drops the sub
+ * with nodeId subtree.nodeId (and everything below it) from that node.
+ */
+class NodeTreeChange {
+ public:
+  enum Op { ADD = 0, REMOVE = 1 };
+
+  uint8_t op = ADD;
+  uint32_t parentId = 0;
+  NodeTree subtree;
+
+  NodeTreeChange() {}
+  NodeTreeChange(uint8_t op, uint32_t parentId, NodeTree subtree)
+      : op(op), parentId(parentId), subtree(std::move(subtree)) {}
+
+  uint32_t size() {
+    return sizeof(op) + sizeof(parentId) + subtree.size();
   }
 };
 }  // namespace protocol
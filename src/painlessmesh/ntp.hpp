@@ -9,6 +9,40 @@
 #define TIME_SYNC_ACCURACY 5000  // Minimum time sync accuracy (5ms
 #endif
 
+#ifndef TIME_SYNC_BURST
+#define TIME_SYNC_BURST 4  // Number of samples taken per time sync
+#endif
+
+#ifndef TIME_SYNC_BURST_INTERVAL
+#define TIME_SYNC_BURST_INTERVAL 50 * TASK_MILLISECOND  // Between the samples
+#endif
+
+#ifndef TIME_SYNC_STEP_THRESHOLD
+#define TIME_SYNC_STEP_THRESHOLD 10000  // Larger offsets are stepped (us)
+#endif
+
+#ifndef TIME_SYNC_SLEW_RATE
+#define TIME_SYNC_SLEW_RATE 500  // Max rate at which offsets are slewed (ppm)
+#endif
+
+#ifndef TIME_SYNC_PROPAGATE_THRESHOLD
+#define TIME_SYNC_PROPAGATE_THRESHOLD 1000  // Smaller changes are not pushed on
+#endif
+
+#ifndef TIME_SYNC_PROPAGATE_JITTER
+#define TIME_SYNC_PROPAGATE_JITTER 2 * TASK_SECOND  // Spread of pushed syncs
+#endif
+
+#ifndef TIME_BEACON_INTERVAL
+#define TIME_BEACON_INTERVAL (10 * TASK_SECOND)  // Time beacon period of the root
+#endif
+
+#ifndef TIME_SYNC_DRIFT_INTERVAL
+// Minimum time between two offsets used to estimate the drift, short enough
+// that every beacon counts even if it arrives a bit early
+#define TIME_SYNC_DRIFT_INTERVAL ((TIME_BEACON_INTERVAL) / 2)
+#endif
+
 #include "Arduino.h"
 
 #if defined(DebugWithDebugger) && defined(ESP8266)
@@ -28,15 +62,293 @@ class MeshTime {
  public:
   /** Returns the mesh time in microsecond precision.
    *
-   * Time rolls over every 71 minutes.
+   * Time rolls over every 71 minutes, use getNodeTime64() to measure longer
+   * intervals.
    *
    * Nodes try to keep a common time base synchronizing to each other using [an
    * SNTP based
    * protocol](https://gitlab.com/painlessMesh/painlessMesh/wikis/mesh-protocol#time-sync)
    */
-  uint32_t getNodeTime() { return micros() + timeOffset; }
+  uint32_t getNodeTime() { return nodeTimeAt(micros()); }
+
+  /**
+   * Returns the mesh time in microsecond precision, without roll over
+   *
+   * The lower 32 bits are equal to getNodeTime(), which is also what is sent
+   * over the wire. The upper bits are kept locally, so they can differ
+   * between nodes: use expandTime() to compare a (32 bit) time received from
+   * another node.
+   *
+   * The roll over of micros() is only noticed if the time is read at least
+   * every 35 minutes, which the mesh takes care of.
+   */
+  uint64_t getNodeTime64() { return nodeTimeAt64(micros()); }
+
+  /**
+   * The mesh time at the given local time (as returned by micros())
+   *
+   * Small offsets found by the time sync are not applied at once, but slewed
+   * in gradually, and the estimated drift of the local clock is corrected
+   * continuously. Both are brought up to date here.
+   */
+  uint32_t nodeTimeAt(uint32_t localTime) {
+    return (uint32_t)nodeTimeAt64(localTime);
+  }
+
+  uint64_t nodeTimeAt64(uint32_t localTime) {
+    discipline(localTime);
+    return localTime64(localTime) + timeOffset;
+  }
+
+  /**
+   * Convert a 32 bit mesh time (e.g. one received in a package) into the 64
+   * bit mesh time closest to now
+   */
+  uint64_t expandTime(uint32_t time) {
+    auto now = getNodeTime64();
+    return now + (int32_t)(time - (uint32_t)now);
+  }
+
+  /**
+   * Estimated frequency error of the local clock compared to the mesh time in
+   * parts per billion
+   */
+  int32_t drift() const { return driftPpb; }
+
+  /**
+   * Whether the time changed by at least TIME_SYNC_PROPAGATE_THRESHOLD since
+   * the last time this returned true
+   *
+   * Used to decide whether the nodes that take their time from us should be
+   * synced early.
+   */
+  bool propagateTimeChange() {
+    if (timeChange < TIME_SYNC_PROPAGATE_THRESHOLD &&
+        timeChange > -TIME_SYNC_PROPAGATE_THRESHOLD)
+      return false;
+    timeChange = 0;
+    return true;
+  }
+
+  /**
+   * Whether the time follows the beacons of the root, i.e. a beacon was
+   * received in the last three beacon intervals
+   *
+   * A stale beacon is forgotten, so it can not look recent again once the
+   * local time rolls over
+   */
+  bool beaconLocked(uint32_t localTime) {
+    if (beaconReceived && (uint32_t)(localTime - lastBeaconAt) >=
+                              3 * (uint32_t)(TIME_BEACON_INTERVAL) * 1000)
+      beaconReceived = false;
+    return beaconReceived;
+  }
+
+ protected:
+  int64_t timeOffset = 0;
+
+  /// Part of the last offset that still needs to be slewed in
+  int32_t slewRemaining = 0;
+  int64_t slewCredit = 0;
+  int32_t driftPpb = 0;
+  int64_t driftRemainder = 0;
+  uint32_t lastDiscipline = 0;
+  uint32_t lastAdjust = 0;
+  bool disciplined = false;
+  bool adjusted = false;
+  /// Change of the time not yet passed on, see propagateTimeChange()
+  int64_t timeChange = 0;
+
+  bool beaconReceived = false;
+  uint32_t lastBeaconAt = 0;
+  uint32_t beaconSequence = 0;
+  /// The neighbour the beacons arrive from
+  uint32_t beaconSource = 0;
+  /// Number of hops between the root and this node
+  uint16_t beaconHops = 0;
+
+  /**
+   * Remember the beacon, unless we follow beacons already and it is not newer
+   * than the last one
+   */
+  bool acceptBeacon(uint32_t from, uint32_t sequence, uint16_t hops,
+                    uint32_t localTime) {
+    if (beaconLocked(localTime) && (int32_t)(sequence - beaconSequence) <= 0)
+      return false;
+    beaconReceived = true;
+    lastBeaconAt = localTime;
+    beaconSequence = sequence;
+    beaconSource = from;
+    beaconHops = hops;
+    return true;
+  }
+
+  /**
+   * Correct the mesh time by offset, as measured at localTime
+   *
+   * Offsets larger than TIME_SYNC_STEP_THRESHOLD are applied at once, smaller
+   * ones are slewed in at TIME_SYNC_SLEW_RATE. The part of the offset that was
+   * not caused by the previous correction is used to update the drift
+   * estimate (a frequency locked loop).
+   */
+  void adjustTime(int32_t offset, uint32_t localTime) {
+    discipline(localTime);
+    timeChange += offset;
+    if (offset >= TIME_SYNC_STEP_THRESHOLD ||
+        offset <= -TIME_SYNC_STEP_THRESHOLD) {
+      timeOffset += offset;
+      slewRemaining = 0;
+      adjusted = false;  // Large jump, start drift estimation over
+      return;
+    }
+    auto elapsed = localTime - lastAdjust;
+    if (adjusted && elapsed >= (uint32_t)(TIME_SYNC_DRIFT_INTERVAL) * 1000) {
+      int64_t residual = offset - slewRemaining;
+      int64_t ppb = residual * 1000000000 / elapsed;
+      driftPpb += ppb / 4;  // Damped
+      if (driftPpb > 500000) driftPpb = 500000;
+      if (driftPpb < -500000) driftPpb = -500000;
+    }
+    slewRemaining = offset;
+    slewCredit = 0;
+    lastAdjust = localTime;
+    adjusted = true;
+  }
+
+  /// Last seen micros(), extended to 64 bits
+  uint64_t lastLocalTime = 0;
+  bool localTimeStarted = false;
+
+  /**
+   * Extend micros() to 64 bits
+   *
+   * Times somewhat in the past (e.g. the arrival time of a package) are
+   * handled as well.
+   */
+  uint64_t localTime64(uint32_t localTime) {
+    if (!localTimeStarted) {
+      localTimeStarted = true;
+      lastLocalTime = localTime;
+      return lastLocalTime;
+    }
+    int32_t elapsed = localTime - (uint32_t)lastLocalTime;
+    if (elapsed <= 0) return lastLocalTime + elapsed;
+    lastLocalTime += elapsed;
+    return lastLocalTime;
+  }
+
+  void discipline(uint32_t localTime) {
+    if (!disciplined) {
+      disciplined = true;
+      lastDiscipline = localTime;
+      lastAdjust = localTime;
+      return;
+    }
+    int32_t elapsed = localTime - lastDiscipline;
+    if (elapsed <= 0) return;  // Asked for a time in the past
+    lastDiscipline = localTime;
+    if (driftPpb != 0) {
+      driftRemainder += (int64_t)elapsed * driftPpb;
+      int32_t step = driftRemainder / 1000000000;
+      driftRemainder -= (int64_t)step * 1000000000;
+      timeOffset += step;
+    }
+    if (slewRemaining != 0) {
+      slewCredit += (int64_t)elapsed * TIME_SYNC_SLEW_RATE;
+      int32_t step = slewCredit / 1000000;
+      if (step == 0) return;
+      if (step > abs(slewRemaining)) step = abs(slewRemaining);
+      if (slewRemaining < 0) step = -step;
+      timeOffset += step;
+      slewRemaining -= step;
+      slewCredit -= (int64_t)abs(step) * 1000000;
+      if (slewRemaining == 0) slewCredit = 0;
+    }
+  }
+};
+
+/**
+ * Quality of the time sync with a neighbour
+ */
+struct SyncStats {
+  /// Offset applied after the last completed sync (us)
+  int32_t offset = 0;
+  /// Round trip time of the last sample (us), -1 if unknown
+  int32_t roundTrip = -1;
+  /// Bound on the error of the last offset (us), the one way delay of the
+  /// sample it was based on
+  uint32_t errorBound = 0;
+  /// Number of samples taken
+  uint32_t samples = 0;
+  /// Number of completed syncs
+  uint32_t syncs = 0;
+  /// Local time (micros()) of the last completed sync
+  uint32_t lastSync = 0;
+
+  void synced(int32_t offset, uint32_t errorBound, uint32_t localTime) {
+    this->offset = offset;
+    this->errorBound = errorBound;
+    lastSync = localTime;
+    ++syncs;
+  }
+
+  /// Microseconds since the last completed sync (only valid if syncs > 0)
+  uint32_t sinceSync(uint32_t localTime) const { return localTime - lastSync; }
+};
+
+/**
+ * A single time sync measurement
+ */
+struct TimeSample {
+  int32_t offset = 0;
+  int32_t delay = 0;
+};
+
+/**
+ * Collects the samples of a time sync burst
+ *
+ * Of all the samples the one with the smallest round trip delay is used, since
+ * it is the one least affected by queuing along the way.
+ */
+class SampleFilter {
+ public:
+  /**
+   * Add a sample measured at localTime
+   *
+   * Samples from an earlier burst that was never finished (more than a second
+   * ago) are dropped.
+   */
+  void add(int32_t offset, int32_t delay, uint32_t localTime) {
+    if (no > 0 && localTime - started > 1000000) clear();
+    if (no == 0) started = localTime;
+    if (no < TIME_SYNC_BURST) {
+      samples[no].offset = offset;
+      samples[no].delay = delay;
+      ++no;
+    }
+  }
+
+  size_t size() const { return no; }
+
+  bool complete() const { return no >= TIME_SYNC_BURST; }
+
+  /**
+   * The sample with the smallest round trip delay
+   */
+  TimeSample best() const {
+    TimeSample sample;
+    for (size_t i = 0; i < no; ++i) {
+      if (i == 0 || samples[i].delay < sample.delay) sample = samples[i];
+    }
+    return sample;
+  }
+
+  void clear() { no = 0; }
+
  protected:
-  uint32_t timeOffset = 0;
+  TimeSample samples[TIME_SYNC_BURST];
+  size_t no = 0;
+  uint32_t started = 0;
 };
 
 /**
@@ -54,6 +366,17 @@ inline int32_t clockOffset(uint32_t time0, uint32_t time1, uint32_t time2,
   return offset;
 }
 
+/**
+ * The offset of the local clock according to a single exchange
+ *
+ * Unlike clockOffset() this is the full offset, the caller is responsible for
+ * filtering and applying it gradually.
+ */
+inline int32_t sampleOffset(uint32_t time0, uint32_t time1, uint32_t time2,
+                            uint32_t time3) {
+  return ((int32_t)(time1 - time0) / 2) + ((int32_t)(time2 - time3) / 2);
+}
+
 /**
  * Calculate the time it took to get reply from other node
  *
@@ -64,9 +387,14 @@ inline int32_t tripDelay(uint32_t time0, uint32_t time1, uint32_t time2,
   return ((time3 - time0) - (time2 - time1)) / 2;
 }
 
-inline bool adopt(protocol::NodeTree mesh, protocol::NodeTree connection) {
-  auto mySubCount =
-      layout::size(layout::excludeRoute(std::move(mesh), connection.nodeId));
+inline bool adopt(const protocol::NodeTree& mesh,
+                  const protocol::NodeTree& connection) {
+  // Size of our part of the mesh, i.e. excluding the route to connection
+  uint32_t mySubCount = 1;
+  for (auto&& s : mesh.subs) {
+    if (s.nodeId != 0 && s.nodeId != connection.nodeId)
+      mySubCount += layout::size(s);
+  }
   auto remoteSubCount = layout::size(connection);
   if (mySubCount > remoteSubCount) return false;
   if (mySubCount == remoteSubCount) {
@@ -77,6 +405,76 @@ inline bool adopt(protocol::NodeTree mesh, protocol::NodeTree connection) {
   return true;
 }
 
+/**
+ * Version of adopt that uses the cached aggregates of the layout instead of
+ * walking the tree
+ */
+template <class T>
+inline bool adopt(const layout::Layout<T>& mesh, const T& connection) {
+  uint32_t remoteSubCount = 1;
+  auto mySubCount = mesh.size();
+  if (connection.nodeId != 0) {
+    remoteSubCount = connection.subtreeSize;
+    mySubCount -= remoteSubCount;
+  }
+  if (mySubCount > remoteSubCount) return false;
+  if (mySubCount == remoteSubCount) {
+    if (connection.nodeId == 0)
+      Log(logger::ERROR, "Adopt called on uninitialized connection\n");
+    return mesh.getNodeId() < connection.nodeId;
+  }
+  return true;
+}
+
+/**
+ * Position of the outgoing time stamp in the msg of the package, -1 if none
+ */
+inline int timeStampAt(const protocol::TimeSync& timeSync) {
+  if (timeSync.msg.type == protocol::TIME_REQUEST)
+    return offsetof(protocol::time_sync_msg_t, t0);
+  if (timeSync.msg.type == protocol::TIME_REPLY)
+    return offsetof(protocol::time_sync_msg_t, t2);
+  return -1;
+}
+
+inline int timeStampAt(const protocol::TimeBeacon& timeBeacon) {
+  return offsetof(protocol::time_beacon_msg_t, time);
+}
+
+/**
+ * Send a TimeSync, TimeDelay or TimeBeacon package to a neighbour
+ *
+ * Its outgoing time stamp (t0 for a request, t2 for a reply) is set again when
+ * the package is actually written to the connection, so time spent in the send
+ * queue does not count as network delay.
+ */
+template <class T, class U>
+bool sendTimed(T& package, std::shared_ptr<U> conn, bool priority = false) {
+  auto variant = Variant<T>(&package);
+  std::string msg;
+  msg.resize(package.size() + sizeof(int));
+  int offset = sizeof(int);
+  variant.serializeTo(msg, offset);
+  // The time stamps are serialized last
+  int stampAt = timeStampAt(package);
+  if (stampAt >= 0) stampAt += offset - sizeof(package.msg);
+  return conn->addMessage(msg, priority, stampAt);
+}
+
+/**
+ * Send a time beacon to all neighbours, except the one with nodeId exclude
+ */
+template <class T>
+void sendTimeBeacons(T& mesh, uint32_t sequence, uint16_t hops,
+                     uint32_t exclude = 0) {
+  for (auto&& conn : mesh.subs) {
+    if (conn->nodeId == 0 || conn->nodeId == exclude) continue;
+    protocol::TimeBeacon beacon(mesh.getNodeId(), conn->nodeId, sequence,
+                                hops);
+    sendTimed(beacon, conn, true);
+  }
+}
+
 template <class T>
 void initTimeSync(protocol::NodeTree mesh, std::shared_ptr<T> connection,
                   uint32_t nodeTime) {
@@ -94,7 +492,7 @@ void initTimeSync(protocol::NodeTree mesh, std::shared_ptr<T> connection,
         connection->nodeId);
   }
 
-  router::send<protocol::TimeSync, T>(timeSync, connection, true);
+  sendTimed<protocol::TimeSync, T>(timeSync, connection, true);
 }
 
 template <class T, class U>
@@ -115,12 +513,12 @@ void handleTimeSync(T& mesh, painlessmesh::protocol::TimeSync* timeSync,
           "node: %u\n",
           conn->nodeId);
       timeSync->reply(mesh.getNodeTime());
-      router::send<painlessmesh::protocol::TimeSync>(*timeSync, conn, true);
+      sendTimed<painlessmesh::protocol::TimeSync>(*timeSync, conn, true);
       break;
 
     case (painlessmesh::protocol::TIME_REQUEST):
       timeSync->reply(receivedAt, mesh.getNodeTime());
-      router::send<painlessmesh::protocol::TimeSync>(*timeSync, conn, true);
+      sendTimed<painlessmesh::protocol::TimeSync>(*timeSync, conn, true);
 
       Log(logger::S_TIME,
           "handleTimeSync(): timeSyncStatus with %u completed\n", conn->nodeId);
@@ -133,13 +531,31 @@ void handleTimeSync(T& mesh, painlessmesh::protocol::TimeSync* timeSync,
       Log(logger::S_TIME,
           "handleTimeSync(): %u adopting TIME_RESPONSE from %u\n", mesh.nodeId,
           conn->nodeId);
-      int32_t offset = painlessmesh::ntp::clockOffset(
+      auto delay = painlessmesh::ntp::tripDelay(
           timeSync->msg.t0, timeSync->msg.t1, timeSync->msg.t2, receivedAt);
-      // auto offset = 10000;
-      // gdb_do_break();
-      mesh.timeOffset += offset;  // Accumulate offset
-      // gdb_do_break();
-      // flag all connections for re-timeSync
+      conn->linkDelay = delay;
+      conn->timeSyncStats.roundTrip = 2 * delay;
+      ++conn->timeSyncStats.samples;
+      if (mesh.followsTimeBeacons()) {
+        // The time comes from the beacons, only the link delay was needed
+        conn->timeSyncSamples.clear();
+        conn->timeSyncTask.delay(TIME_SYNC_INTERVAL);
+        break;
+      }
+      conn->timeSyncSamples.add(
+          painlessmesh::ntp::sampleOffset(timeSync->msg.t0, timeSync->msg.t1,
+                                          timeSync->msg.t2, receivedAt),
+          delay, micros());
+      if (!conn->timeSyncSamples.complete()) {
+        // Take the next sample of the burst
+        conn->timeSyncTask.delay(TIME_SYNC_BURST_INTERVAL);
+        break;
+      }
+      auto best = conn->timeSyncSamples.best();
+      int32_t offset = best.offset;
+      conn->timeSyncSamples.clear();
+      mesh.adjustTime(offset, micros());
+      conn->timeSyncStats.synced(offset, abs(best.delay), micros());
       if (mesh.nodeTimeAdjustedCallback) {
         mesh.nodeTimeAdjustedCallback(offset);
       }
@@ -151,21 +567,34 @@ void handleTimeSync(T& mesh, painlessmesh::protocol::TimeSync* timeSync,
             "handleTimeSync(): timeSyncStatus with %u completed\n",
             conn->nodeId);
 
-        // Time has changed, update other nodes
+        // Time has changed noticeably, update the nodes that take their time
+        // from us. Their syncs are spread out, so the change does not ripple
+        // through the mesh as a burst of exchanges.
+        if (!mesh.propagateTimeChange()) break;
         for (auto&& connection : mesh.subs) {
-          if (connection->nodeId != conn->nodeId) {  // exclude this connection
-            connection->timeSyncTask.forceNextIteration();
+          if (connection->nodeId != conn->nodeId &&  // exclude this connection
+              !adopt(mesh, (*connection))) {
+            connection->timeSyncTask.delay(
+                random(1, TIME_SYNC_PROPAGATE_JITTER));
             Log(logger::S_TIME,
                 "handleTimeSync(): timeSyncStatus with %u brought forward\n",
                 connection->nodeId);
           }
         }
-      } else {
+      } else if (offset >= TIME_SYNC_STEP_THRESHOLD ||
+                 offset <= -TIME_SYNC_STEP_THRESHOLD) {
         // Iterate sync procedure if accuracy was not enough
         conn->timeSyncTask.delay(200 * TASK_MILLISECOND);  // Small delay
         Log(logger::S_TIME,
             "handleTimeSync(): timeSyncStatus with %u needs further tries\n",
             conn->nodeId);
+      } else {
+        // Check again once the offset has been slewed in
+        conn->timeSyncTask.delay((uint32_t)abs(offset) * 1000 /
+                                 TIME_SYNC_SLEW_RATE * TASK_MILLISECOND);
+        Log(logger::S_TIME,
+            "handleTimeSync(): timeSyncStatus with %u needs further tries\n",
+            conn->nodeId);
       }
       break;
     }
@@ -196,7 +625,7 @@ void handleTimeDelay(T& mesh, painlessmesh::protocol::TimeDelay* timeDelay,
 
       // Build time response
       timeDelay->reply(receivedAt, mesh.getNodeTime());
-      router::send<protocol::TimeDelay, U>(*timeDelay, conn);
+      sendTimed<protocol::TimeDelay, U>(*timeDelay, conn);
       break;
 
     case (painlessmesh::protocol::TIME_REPLY): {
@@ -204,11 +633,17 @@ void handleTimeDelay(T& mesh, painlessmesh::protocol::TimeDelay* timeDelay,
       int32_t delay = painlessmesh::ntp::tripDelay(
           timeDelay->msg.t0, timeDelay->msg.t1, timeDelay->msg.t2, receivedAt);
       Log(logger::S_TIME, "handleTimeDelay(): Delay is %d\n", delay);
+      if (timeDelay->from == conn->nodeId) {
+        conn->linkDelay = delay;
+        conn->timeSyncStats.roundTrip = 2 * delay;
+      }
 
       // conn->timeSyncStatus == COMPLETE;
 
       if (mesh.nodeDelayReceivedCallback)
         mesh.nodeDelayReceivedCallback(timeDelay->from, delay);
+      uint32_t t0 = timeDelay->msg.t0;
+      mesh.delayRequests.complete(std::make_pair(timeDelay->from, t0), delay);
     } break;
 
     default:
@@ -219,6 +654,37 @@ void handleTimeDelay(T& mesh, painlessmesh::protocol::TimeDelay* timeDelay,
   Log(logger::S_TIME, "handleTimeSync(): ----------------------------------\n");
 }
 
+template <class T, class U>
+void handleTimeBeacon(T& mesh, protocol::TimeBeacon* timeBeacon,
+                      std::shared_ptr<U> conn, uint32_t receivedAt) {
+  // The root is the reference and beacons only flow away from it
+  if (mesh.isRoot() || !conn->containsRoot) {
+    Log(logger::S_TIME, "handleTimeBeacon(): Ignoring beacon from %u\n",
+        conn->nodeId);
+    return;
+  }
+  if (!mesh.acceptBeacon(conn->nodeId, timeBeacon->msg.sequence,
+                         timeBeacon->msg.hops + 1, micros()))
+    return;
+
+  int32_t delay = conn->linkDelay;
+  if (delay < 0) {
+    // Measure it as soon as possible, until then assume it is small
+    delay = 0;
+    conn->timeSyncTask.forceNextIteration();
+  }
+  int32_t offset = timeBeacon->msg.time + delay - receivedAt;
+  Log(logger::S_TIME, "handleTimeBeacon(): %u from %u, offset %d\n",
+      timeBeacon->msg.sequence, conn->nodeId, offset);
+  mesh.adjustTime(offset, micros());
+  ++conn->timeSyncStats.samples;
+  conn->timeSyncStats.synced(offset, delay, micros());
+  if (mesh.nodeTimeAdjustedCallback) mesh.nodeTimeAdjustedCallback(offset);
+
+  sendTimeBeacons(mesh, timeBeacon->msg.sequence, timeBeacon->msg.hops + 1,
+                  conn->nodeId);
+}
+
 template <class T, typename U>
 callback::MeshPackageCallbackList<U> addPackageCallback(
     callback::MeshPackageCallbackList<U>&& callbackList, T& mesh) {
@@ -232,6 +698,17 @@ callback::MeshPackageCallbackList<U> addPackageCallback(
         return false;
       });
 
+  // TimeBeacon
+  callbackList.onPackage(
+      protocol::TIME_BEACON,
+      [&mesh](VariantBase* variant, std::shared_ptr<U> connection,
+              uint32_t receivedAt) {
+        auto timeBeacon = static_cast<Variant<protocol::TimeBeacon>*>(variant);
+        handleTimeBeacon<T, U>(mesh, timeBeacon->package, connection,
+                               receivedAt);
+        return false;
+      });
+
   // TimeDelay
   callbackList.onPackage(
       protocol::TIME_DELAY,
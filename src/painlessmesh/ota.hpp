@@ -386,7 +386,7 @@ void addSendPackageCallback(Scheduler& scheduler,
     Serial.printf_P(PSTR("Send Ota Package %zu, %d, "), reply.dest, reply.partNo);
     Serial.println(reply.role);
     mesh.sendPackage(&reply);
-    return true;
+    return false;
   });
 
 #endif
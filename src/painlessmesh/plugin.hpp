@@ -1,12 +1,19 @@
 #ifndef _PAINLESS_MESH_PLUGIN_HPP_
 #define _PAINLESS_MESH_PLUGIN_HPP_
 
+#include <list>
+#include <vector>
+
 #include "Arduino.h"
 #include "painlessmesh/configuration.hpp"
 
 #include "painlessmesh/router.hpp"
 #include "painlessmesh/variant.hpp"
 
+#ifndef TASK_POOL_SIZE
+#define TASK_POOL_SIZE 16  // Maximum number of idle tasks kept for reuse
+#endif
+
 namespace painlessmesh {
 
 
@@ -19,7 +26,7 @@ namespace painlessmesh {
  * measurements done by the sensors. The packages related to OTA updates are
  * also implemented as a plugin system (see plugin::ota). Each package type is
  * uniquely identified using the protocol::PackageInterface::type. Currently
- * default package types use numbers up to 12, so to be on the safe side we
+ * default package types use numbers up to 16, so to be on the safe side we
  * recommend your own packages to use higher type values, e.g. start counting at
  * 20 at the lowest.
  *
@@ -121,11 +128,15 @@ template <typename T>
 class PackageHandler : public layout::Layout<T> {
  public:
   void stop() {
-    for (auto&& task : taskList) {
-      task->disable();
-      task->setCallback(NULL);
+    for (auto&& pooled : taskList) {
+      pooled.task->disable();
+      pooled.task->setCallback(NULL);
+      pooled.task->setOnDisable(NULL);
     }
+    freeTasks.clear();
+    parkedTasks.clear();
     taskList.clear();
+    sweepAt = taskList.end();
   }
 
   virtual ~PackageHandler() {
@@ -154,11 +165,18 @@ class PackageHandler : public layout::Layout<T> {
     return false;
   }
 
+  /**
+   * Add a handler for packages of the given type
+   *
+   * Handlers with a higher priority are called first. A handler that returns
+   * true consumes the package, the remaining handlers are then skipped.
+   */
   void onPackage(int type,
-                 std::function<bool(painlessmesh::VariantBase*)> function) {
+                 std::function<bool(painlessmesh::VariantBase*)> function,
+                 int priority = 0) {
     auto func = [function](painlessmesh::VariantBase* var, std::shared_ptr<T>,
                            uint32_t) { return function(var); };
-    this->callbackList.onPackage(type, func);
+    this->callbackList.onPackage(type, func, priority);
   }
 
   /**
@@ -168,24 +186,38 @@ class PackageHandler : public layout::Layout<T> {
    * returned. If the task is anonymous (i.e. no shared_ptr to it is held
    * anywhere else) and disabled then it will be reused when a new task is
    * added.
+   *
+   * Tasks are put on a free list when they are disabled, so finding one to
+   * reuse does not depend on the number of tasks. Disabled tasks that are
+   * still held elsewhere are parked and checked again one at a time.
+   *
+   * The free list relies on the OnDisable callback of the task. If it is
+   * replaced with setOnDisable(), the task is found again by releaseTasks().
    */
   std::shared_ptr<Task> addTask(Scheduler& scheduler, unsigned long aInterval,
                                 long aIterations,
                                 std::function<void()> aCallback) {
     using namespace painlessmesh::logger;
-    for (auto&& task : taskList) {
-      if (task.use_count() == 1 && !task->isEnabled()) {
-        task->set(aInterval, aIterations, aCallback, NULL, NULL);
-        task->enable();
-        return task;
-      }
+    while (!freeTasks.empty()) {
+      auto it = freeTasks.back();
+      freeTasks.pop_back();
+      if (reusable(it)) return reuse(it, aInterval, aIterations, aCallback);
+      park(it);
+    }
+
+    if (!parkedTasks.empty()) {
+      auto it = parkedTasks.front();
+      parkedTasks.pop_front();
+      if (reusable(it)) return reuse(it, aInterval, aIterations, aCallback);
+      park(it);
     }
 
     std::shared_ptr<Task> task =
         std::make_shared<Task>(aInterval, aIterations, aCallback);
+    taskList.push_front(PooledTask(task));
+    task->setOnDisable(onDisable(taskList.begin()));
     scheduler.addTask((*task));
     task->enable();
-    taskList.push_front(task);
     return task;
   }
 
@@ -194,9 +226,87 @@ class PackageHandler : public layout::Layout<T> {
     return this->addTask(scheduler, 0, TASK_ONCE, aCallback);
   }
 
+  /**
+   * Release the idle tasks that do not fit in the pool (TASK_POOL_SIZE)
+   *
+   * Each call also checks one of the other tasks, to return disabled tasks
+   * whose OnDisable callback was replaced to the free list.
+   *
+   * Releasing a task removes it from the scheduler, so this should not be
+   * called while the scheduler is executing.
+   */
+  void releaseTasks() {
+    if (sweepAt == taskList.end()) sweepAt = taskList.begin();
+    if (sweepAt != taskList.end()) {
+      if (sweepAt->state == PooledTask::ACTIVE && !sweepAt->task->isEnabled()) {
+        sweepAt->state = PooledTask::FREE;
+        freeTasks.push_back(sweepAt);
+      }
+      ++sweepAt;
+    }
+
+    while (freeTasks.size() > TASK_POOL_SIZE) {
+      auto it = freeTasks.back();
+      freeTasks.pop_back();
+      if (reusable(it)) {
+        if (it == sweepAt) ++sweepAt;
+        taskList.erase(it);
+      } else {
+        park(it);
+      }
+    }
+  }
+
  protected:
+  struct PooledTask {
+    enum State { ACTIVE, FREE, PARKED };
+
+    PooledTask(std::shared_ptr<Task> task) : task(task) {}
+
+    std::shared_ptr<Task> task;
+    State state = ACTIVE;
+  };
+  typedef typename std::list<PooledTask>::iterator pool_iterator;
+
   callback::MeshPackageCallbackList<T> callbackList;
-  std::list<std::shared_ptr<Task> > taskList = {};
+  std::list<PooledTask> taskList = {};
+  /// Tasks that were disabled since they were last (re)used
+  std::vector<pool_iterator> freeTasks;
+  /// Disabled tasks that were still held elsewhere when we tried to reuse them
+  std::list<pool_iterator> parkedTasks;
+  /// The next task releaseTasks() checks
+  pool_iterator sweepAt = taskList.end();
+
+  std::function<void()> onDisable(pool_iterator it) {
+    return [this, it]() {
+      if (it->state != PooledTask::ACTIVE) return;
+      it->state = PooledTask::FREE;
+      freeTasks.push_back(it);
+    };
+  }
+
+  bool reusable(pool_iterator it) const {
+    return it->task.use_count() == 1 && !it->task->isEnabled();
+  }
+
+  void park(pool_iterator it) {
+    // Once enabled again it will return to the free list when disabled
+    if (it->task->isEnabled()) {
+      it->state = PooledTask::ACTIVE;
+      return;
+    }
+    it->state = PooledTask::PARKED;
+    parkedTasks.push_back(it);
+  }
+
+  std::shared_ptr<Task> reuse(pool_iterator it, unsigned long aInterval,
+                              long aIterations,
+                              std::function<void()> aCallback) {
+    it->state = PooledTask::ACTIVE;
+    it->task->set(aInterval, aIterations, aCallback, NULL, onDisable(it));
+    it->task->enable();
+    return it->task;
+  }
 };
 
 }  // namespace plugin
@@ -33,12 +33,18 @@ namespace protocol {
 
 enum Type {
   NONE = 0,
+  BROADCAST_AT = 1,  // application data for everyone, delivered at a time
+  TIME_BEACON = 2,
   TIME_DELAY = 3,
   TIME_SYNC = 4,
   NODE_SYNC_REQUEST = 5,
   NODE_SYNC_REPLY = 6,
+  NODE_SYNC_DELTA = 7,
   BROADCAST = 8,  // application data for everyone
-  SINGLE = 9      // application data for a single node,
+  SINGLE = 9,     // application data for a single node,
+  TIME_SYNC_REPORT = 14,
+  REQUEST = 15,   // application request, answered with a RESPONSE
+  RESPONSE = 16
 };
 
 enum TimeType {
@@ -161,9 +167,109 @@ class Broadcast : public Single {
   }
 };
 
+/**
+ * Broadcast package that should be delivered at the given mesh time
+ */
+class BroadcastAt : public Broadcast {
+ public:
+  /// The (lower 32 bits of the) mesh time of delivery
+  uint32_t time = 0;
+
+  BroadcastAt(ProtocolHeader header) : Broadcast(header) {}
+
+  BroadcastAt(uint32_t fromID, uint32_t time, std::string& message)
+      : Broadcast(fromID, message) {
+    header.type = BROADCAST_AT;
+    this->time = time;
+  }
+
+  uint32_t size() override { return Broadcast::size() + sizeof(time); }
+};
+
+/**
+ * Request package, the answer is a Response with the same id
+ */
+class Request : public Single {
+ public:
+  /// Correlation id, unique for the requesting node
+  uint32_t id = 0;
+
+  Request(ProtocolHeader header) : Single(header) {}
+
+  Request(uint32_t fromID, uint32_t destID, uint32_t id, std::string& message)
+      : Single(fromID, destID, message) {
+    header.type = REQUEST;
+    this->id = id;
+  }
+
+  uint32_t size() override { return Single::size() + sizeof(id); }
+};
+
+/**
+ * Response package, the answer to the Request with the same id
+ */
+class Response : public Request {
+ public:
+  Response(ProtocolHeader header) : Request(header) {}
+
+  Response(uint32_t fromID, uint32_t destID, uint32_t id, std::string& message)
+      : Request(fromID, destID, id, message) {
+    header.type = RESPONSE;
+  }
+};
+
+struct time_sync_report_t {
+  /// Hops from the root the time comes from, -1 if unknown
+  int16_t stratum = -1;
+  /// Estimated frequency error of the local clock (ppb)
+  int32_t drift = 0;
+  /// Offset applied by the last sync (us)
+  int32_t offset = 0;
+  /// Bound on the error of the last sync (us)
+  uint32_t errorBound = 0;
+  /// Time since the last sync (ms), UINT32_MAX if never synced
+  uint32_t sinceSync = UINT32_MAX;
+  /// Number of time samples taken
+  uint32_t samples = 0;
+} __attribute__((packed));
+
+/**
+ * TimeSyncReport package
+ *
+ * Broadcast by nodes to let others monitor the quality of their time sync
+ */
+class TimeSyncReport : public PackageInterface {
+ public:
+  uint32_t from;
+  time_sync_report_t msg;
+
+  TimeSyncReport(ProtocolHeader header) : PackageInterface(header) {}
+
+  TimeSyncReport(uint32_t fromID = 0)
+      : PackageInterface(TIME_SYNC_REPORT, router::BROADCAST) {
+    from = fromID;
+  }
+
+  uint32_t size() override {
+    return PackageInterface::size() + sizeof(from) + sizeof(msg);
+  }
+};
+
+/**
+ * Optional features a node announces in its NodeSync packages
+ *
+ * They are send as a trailing byte, which older nodes do not read.
+ */
+enum NodeSyncFeature {
+  /// The node understands NodeSyncDelta packages
+  FEATURE_NODE_SYNC_DELTA = 1 << 0
+};
+
 class NodeSync : public NodeTree, public PackageInterface {
  public:
   uint32_t from;
+  /// Features of the sender (see NodeSyncFeature), 0 for older nodes
+  uint8_t features = 0;
 
   NodeSync(Type type = NONE) : PackageInterface(type, router::NEIGHBOUR) {}
   NodeSync(ProtocolHeader header) : PackageInterface(header) {}
@@ -172,7 +278,7 @@ class NodeSync : public NodeTree, public PackageInterface {
       : NodeSync(type) {
     from = fromID;
     header.dest = destID;
-    subs = subTree;
+    subs = std::move(subTree);
     nodeId = fromID;
     root = iAmRoot;
   }
@@ -185,7 +291,9 @@ class NodeSync : public NodeTree, public PackageInterface {
 
   bool operator!=(const NodeSync& b) const { return !this->operator==(b); }
 
-  uint32_t size() override { return NodeTree::size() + sizeof(from); }
+  uint32_t size() override {
+    return NodeTree::size() + sizeof(from) + sizeof(features);
+  }
 };
 
 /**
@@ -197,7 +305,7 @@ class NodeSyncRequest : public NodeSync {
   NodeSyncRequest(ProtocolHeader header) : NodeSync(header) {}
   NodeSyncRequest(uint32_t fromID, uint32_t destID, std::list<NodeTree> subTree,
                   bool iAmRoot = false)
-      : NodeSync(fromID, destID, subTree, iAmRoot, NODE_SYNC_REQUEST) {}
+      : NodeSync(fromID, destID, std::move(subTree), iAmRoot, NODE_SYNC_REQUEST) {}
 };
 
 /**
@@ -209,7 +317,51 @@ class NodeSyncReply : public NodeSync {
   NodeSyncReply(ProtocolHeader header) : NodeSync(header) {}
   NodeSyncReply(uint32_t fromID, uint32_t destID, std::list<NodeTree> subTree,
                 bool iAmRoot = false)
-      : NodeSync(fromID, destID, subTree, iAmRoot, NODE_SYNC_REPLY) {}
+      : NodeSync(fromID, destID, std::move(subTree), iAmRoot, NODE_SYNC_REPLY) {}
+};
+
+/**
+ * NodeSyncDelta package
+ *
+ * Carries only the changes to the layout since the last NodeSync that was send
+ * to the neighbour. Each direction of a connection keeps its own version
+ * counter. The receiver only applies the changes if baseVersion matches the
+ * last version it received, otherwise it falls back to a full NodeSyncRequest.
+ * The hash of the resulting layout (see NodeTree::hash()) is included, so the
+ * receiver can verify the result. If nothing changed the package holds just
+ * the versions and the hash.
+ */
+class NodeSyncDelta : public PackageInterface {
+ public:
+  uint32_t from;
+  uint16_t baseVersion = 0;
+  uint16_t version = 0;
+  uint64_t hash = 0;
+  bool reply = false;
+  std::list<NodeTreeChange> changes;
+
+  NodeSyncDelta() : PackageInterface(NODE_SYNC_DELTA, router::NEIGHBOUR) {}
+  NodeSyncDelta(ProtocolHeader header) : PackageInterface(header) {}
+  NodeSyncDelta(uint32_t fromID, uint32_t destID, uint16_t baseVersion,
+                uint16_t version, std::list<NodeTreeChange> changes,
+                uint64_t hash, bool reply = false)
+      : NodeSyncDelta() {
+    from = fromID;
+    header.dest = destID;
+    this->baseVersion = baseVersion;
+    this->version = version;
+    this->changes = changes;
+    this->hash = hash;
+    this->reply = reply;
+  }
+
+  uint32_t size() override {
+    uint32_t size = PackageInterface::size() + sizeof(from) +
+                    sizeof(baseVersion) + sizeof(version) + sizeof(hash) +
+                    sizeof(reply) + sizeof(uint16_t);
+    for (auto&& c : changes) size += c.size();
+    return size;
+  }
 };
 
 struct time_sync_msg_t {
@@ -308,6 +460,41 @@ class TimeDelay : public TimeSync {
   TimeDelay(ProtocolHeader header) : TimeSync(header) {}
 };
 
+struct time_beacon_msg_t {
+  uint32_t time = 0;
+  uint32_t sequence = 0;
+  uint16_t hops = 0;  // Number of hops from the root
+} __attribute__((packed));
+
+/**
+ * TimeBeacon package
+ *
+ * Sent by the root to its neighbours and passed on down the tree, carrying the
+ * mesh time at the moment it was written to the connection.
+ */
+class TimeBeacon : public PackageInterface {
+ public:
+  uint32_t from;
+  time_beacon_msg_t msg;
+
+  TimeBeacon(ProtocolHeader header) : PackageInterface(header) {}
+
+  TimeBeacon() : PackageInterface(TIME_BEACON, router::NEIGHBOUR) {}
+
+  TimeBeacon(uint32_t fromID, uint32_t destID, uint32_t sequence,
+             uint16_t hops)
+      : TimeBeacon() {
+    from = fromID;
+    header.dest = destID;
+    msg.sequence = sequence;
+    msg.hops = hops;
+  }
+
+  uint32_t size() override {
+    return PackageInterface::size() + sizeof(from) + sizeof(msg);
+  }
+};
+
 }  // namespace protocol
 
 }  // namespace painlessmesh
@@ -0,0 +1,124 @@
+#ifndef _PAINLESS_MESH_REACTOR_HPP_
+#define _PAINLESS_MESH_REACTOR_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "Arduino.h"
+#include "painlessmesh/configuration.hpp"
+
+namespace painlessmesh {
+namespace tcp {
+
+/**
+ * Services the reading and writing of all connections of a mesh with a single
+ * task
+ *
+ * Connections are queued when there is work for them: when a message arrived
+ * (readable()) or when a message was added or the other side acknowledged
+ * data (writable()). The task then handles all queued connections in one go,
+ * so the scheduler only has one task to check, however many connections there
+ * are.
+ *
+ * T should provide:
+ * - bool connected
+ * - bool readQueued, writeQueued (only used by the reactor)
+ * - bool readNext(), routes one received message, returns whether there are
+ *   more
+ * - bool writeNext(), writes (part of) a message, returns whether it succeeded
+ * - bool hasPendingWrites()
+ */
+template <class T>
+class Reactor {
+ public:
+  void init(Scheduler& scheduler) {
+    this->scheduler = &scheduler;
+    task.set(TASK_SECOND, TASK_FOREVER, [this]() { this->run(); });
+    scheduler.addTask(task);
+    task.enableDelayed();
+  }
+
+  /**
+   * The connection has received messages to process
+   */
+  void readable(std::shared_ptr<T> conn) {
+    if (!conn->readQueued) {
+      conn->readQueued = true;
+      reads.push_back(conn);
+    }
+    task.forceNextIteration();
+  }
+
+  /**
+   * The connection has messages to write and/or room to write them
+   */
+  void writable(std::shared_ptr<T> conn) {
+    if (!conn->writeQueued) {
+      conn->writeQueued = true;
+      writes.push_back(conn);
+    }
+    task.forceNextIteration();
+  }
+
+  /**
+   * Stop the task and remove it from the scheduler
+   *
+   * The scheduler can be deleted before the reactor (e.g. by ~Mesh), after
+   * which ~Task would use it.
+   */
+  void stop() {
+    task.disable();
+    task.setCallback(NULL);
+    if (scheduler) scheduler->deleteTask(task);
+    scheduler = NULL;
+    reads.clear();
+    writes.clear();
+    blocked.clear();
+  }
+
+ protected:
+  Scheduler* scheduler = NULL;
+  Task task;
+  std::vector<std::shared_ptr<T>> reads;
+  std::vector<std::shared_ptr<T>> writes;
+  /// Connections with data that could not be written yet
+  std::vector<std::shared_ptr<T>> blocked;
+
+  /// Swapped with the queues, so connections that become ready while we are
+  /// busy end up in the next iteration
+  std::vector<std::shared_ptr<T>> current;
+
+  void run() {
+    // Route one message per connection per iteration, so a busy connection
+    // can not starve the others
+    current.swap(reads);
+    for (auto&& conn : current) {
+      conn->readQueued = false;
+      if (conn->connected && conn->readNext()) readable(conn);
+    }
+    current.clear();
+
+    writes.insert(writes.end(), blocked.begin(), blocked.end());
+    blocked.clear();
+    current.swap(writes);
+    for (auto&& conn : current) {
+      conn->writeQueued = false;
+      if (!conn->connected) continue;
+      while (conn->writeNext()) {
+      }
+      if (conn->hasPendingWrites()) {
+        conn->writeQueued = true;
+        blocked.push_back(conn);
+      }
+    }
+    current.clear();
+
+    if (!reads.empty() || !writes.empty())
+      task.forceNextIteration();
+    else if (!blocked.empty())
+      task.delay(100 * TASK_MILLISECOND);  // Try again later
+  }
+};
+}  // namespace tcp
+}  // namespace painlessmesh
+#endif
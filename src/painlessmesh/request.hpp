@@ -0,0 +1,218 @@
+#ifndef _PAINLESS_MESH_REQUEST_HPP_
+#define _PAINLESS_MESH_REQUEST_HPP_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Arduino.h"
+#include "painlessmesh/configuration.hpp"
+
+#include "painlessmesh/timer.hpp"
+
+#ifndef REQUEST_TIMEOUT
+#define REQUEST_TIMEOUT 10 * TASK_SECOND  // Default time to wait for a reply
+#endif
+
+namespace painlessmesh {
+
+/**
+ * Requests that are answered asynchronously by another node
+ *
+ * Every request gets a Pending result, which is completed when the answer
+ * arrives, the request times out or it is cancelled. Any number of requests
+ * can be in flight at the same time, each is matched to its answer by a key
+ * (e.g. a correlation id).
+ */
+namespace request {
+
+enum Status { PENDING, DONE, TIMEOUT, CANCELLED, FAILED };
+
+template <typename R, typename Key>
+class Tracker;
+
+/**
+ * The result of a request, that becomes available later
+ *
+ * \code
+ * mesh.sendRequest(nodeId, "status")->then([](auto status, auto reply) {
+ *   if (status == request::DONE) Serial.println(reply.c_str());
+ * });
+ * \endcode
+ */
+template <typename R>
+class Pending : public std::enable_shared_from_this<Pending<R>> {
+ public:
+  typedef std::function<void(Status status, R& result)> callback_t;
+
+  /**
+   * Call cb when the request completes, or at once if it already has
+   */
+  std::shared_ptr<Pending> then(callback_t cb) {
+    if (done())
+      cb(mStatus, mResult);
+    else
+      callbacks.push_back(cb);
+    return this->shared_from_this();
+  }
+
+  bool done() const { return mStatus != PENDING; }
+
+  Status status() const { return mStatus; }
+
+  /**
+   * The answer (only valid if status() == DONE)
+   */
+  R& result() { return mResult; }
+
+  /**
+   * Stop waiting for the answer, the callbacks are called with CANCELLED
+   */
+  void cancel() {
+    if (done()) return;
+    auto forget = onCancel;
+    if (forget) forget();
+    finish(CANCELLED, R());
+  }
+
+ protected:
+  Status mStatus = PENDING;
+  R mResult = R();
+  std::vector<callback_t> callbacks;
+  /// Removes the request from its tracker
+  std::function<void()> onCancel;
+
+  void finish(Status status, R result) {
+    if (done()) return;
+    mStatus = status;
+    mResult = result;
+    onCancel = NULL;
+    auto cbs = std::move(callbacks);
+    callbacks.clear();
+    for (auto&& cb : cbs) cb(mStatus, mResult);
+  }
+
+  template <typename, typename>
+  friend class Tracker;
+};
+
+/**
+ * Keeps track of the requests that wait for an answer
+ *
+ * Requests are stored by key, completing a key completes all requests with
+ * that key. The time outs run on the timer wheel of the mesh.
+ */
+template <typename R, typename Key = uint32_t>
+class Tracker {
+ public:
+  Tracker() {}
+  Tracker(const Tracker&) = delete;
+  Tracker& operator=(const Tracker&) = delete;
+
+  ~Tracker() { stop(); }
+
+  void init(timer::Wheel& wheel) { this->wheel = &wheel; }
+
+  /**
+   * A new, unique, correlation id
+   */
+  uint32_t nextId() {
+    if (++lastId == 0) ++lastId;
+    return lastId;
+  }
+
+  /**
+   * Start waiting for the answer with the given key
+   */
+  std::shared_ptr<Pending<R>> start(Key key, unsigned long timeout) {
+    auto pending = std::make_shared<Pending<R>>();
+    auto it = entries.insert(std::make_pair(key, Entry()));
+    it->second.pending = pending;
+    it->second.timeout.reset(new timer::Timer());
+    std::weak_ptr<Pending<R>> weak = pending;
+    it->second.timeout->set(timeout, TASK_ONCE, [this, key, weak]() {
+      this->finish(key, weak.lock(), TIMEOUT);
+    });
+    pending->onCancel = [this, key, weak]() { this->remove(key, weak.lock()); };
+    if (wheel) {
+      wheel->addTimer(*it->second.timeout);
+      it->second.timeout->enableDelayed();
+    }
+    return pending;
+  }
+
+  /**
+   * Complete all requests with the given key
+   *
+   * @return Whether any request was waiting for it
+   */
+  bool complete(Key key, R result) {
+    auto pendings = take(key);
+    for (auto&& pending : pendings) pending->finish(DONE, result);
+    return !pendings.empty();
+  }
+
+  /**
+   * Fail all requests with the given key (e.g. because they could not be
+   * sent)
+   */
+  void fail(Key key) {
+    for (auto&& pending : take(key)) pending->finish(FAILED, R());
+  }
+
+  /**
+   * The number of requests waiting for an answer
+   */
+  size_t size() const { return entries.size(); }
+
+  /**
+   * Cancel all requests
+   */
+  void stop() {
+    std::vector<std::shared_ptr<Pending<R>>> pendings;
+    for (auto&& entry : entries) pendings.push_back(entry.second.pending);
+    entries.clear();
+    for (auto&& pending : pendings) pending->finish(CANCELLED, R());
+  }
+
+ protected:
+  struct Entry {
+    std::shared_ptr<Pending<R>> pending;
+    std::unique_ptr<timer::Timer> timeout;
+  };
+
+  timer::Wheel* wheel = NULL;
+  std::multimap<Key, Entry> entries;
+  uint32_t lastId = 0;
+
+  std::vector<std::shared_ptr<Pending<R>>> take(Key key) {
+    std::vector<std::shared_ptr<Pending<R>>> pendings;
+    auto range = entries.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+      pendings.push_back(it->second.pending);
+    entries.erase(range.first, range.second);
+    return pendings;
+  }
+
+  void remove(Key key, std::shared_ptr<Pending<R>> pending) {
+    auto range = entries.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.pending == pending) {
+        entries.erase(it);
+        return;
+      }
+    }
+  }
+
+  void finish(Key key, std::shared_ptr<Pending<R>> pending, Status status) {
+    if (!pending) return;
+    // Called from the timer of the entry, which is deleted by remove(). The
+    // timer does not touch itself after calling us, so that is safe.
+    remove(key, pending);
+    pending->finish(status, R());
+  }
+};
+}  // namespace request
+}  // namespace painlessmesh
+#endif
@@ -24,18 +24,21 @@ namespace painlessmesh {
  */
 namespace router {
 template <class T>
-std::shared_ptr<T> findRoute(layout::Layout<T> tree,
+std::shared_ptr<T> findRoute(const layout::Layout<T>& tree,
                              std::function<bool(std::shared_ptr<T>)> func) {
   auto route = std::find_if(tree.subs.begin(), tree.subs.end(), func);
   if (route == tree.subs.end()) return NULL;
   return (*route);
 }
 
+/**
+ * The neighbour to send a message for nodeId to (NULL if not in the mesh)
+ *
+ * Uses the route index of the layout, see Layout::nextHop()
+ */
 template <class T>
-std::shared_ptr<T> findRoute(layout::Layout<T> tree, uint32_t nodeId) {
-  return findRoute<T>(tree, [nodeId](std::shared_ptr<T> s) {
-    return layout::contains((*s), nodeId);
-  });
+std::shared_ptr<T> findRoute(const layout::Layout<T>& tree, uint32_t nodeId) {
+  return tree.nextHop(nodeId);
 }
 
 template <class T, class U>
@@ -58,7 +61,7 @@ bool send(Variant<T>* variant, std::shared_ptr<U> conn, bool priority = false) {
 }
 
 template <class T, class U>
-bool send(T& package, layout::Layout<U> layout) {
+bool send(T& package, const layout::Layout<U>& layout) {
   auto variant = Variant<T>(&package);
   std::string msg;
   msg.resize(package.size() + sizeof(int));
@@ -70,7 +73,7 @@ bool send(T& package, layout::Layout<U> layout) {
 }
 
 template <class T, class U>
-bool send(Variant<T>* variant, layout::Layout<U> layout) {
+bool send(Variant<T>* variant, const layout::Layout<U>& layout) {
   std::string msg;
 
   msg.resize(variant->size() + sizeof(int));
@@ -82,7 +85,7 @@ bool send(Variant<T>* variant, layout::Layout<U> layout) {
 }
 template <class U>
 bool send(std::string& msg, protocol::ProtocolHeader& header,
-          layout::Layout<U> layout) {
+          const layout::Layout<U>& layout) {
   auto conn = findRoute<U>(layout, header.dest);
   if (conn) {
     msg.insert(0, 4, '\0');
@@ -92,7 +95,8 @@ bool send(std::string& msg, protocol::ProtocolHeader& header,
 }
 
 template <class T, class U>
-size_t broadcast(T& package, layout::Layout<U> layout, uint32_t exclude) {
+size_t broadcast(T& package, const layout::Layout<U>& layout,
+                 uint32_t exclude) {
   auto variant = Variant<T>(&package);
   std::string msg;
   msg.resize(package.size() + sizeof(int));
@@ -110,7 +114,7 @@ size_t broadcast(T& package, layout::Layout<U> layout, uint32_t exclude) {
 }
 
 template <class T>
-size_t broadcast(VariantBase* variant, layout::Layout<T> layout,
+size_t broadcast(VariantBase* variant, const layout::Layout<T>& layout,
                  uint32_t exclude) {
   std::string msg;
   msg.resize(variant->size() + sizeof(int));
@@ -127,7 +131,8 @@ size_t broadcast(VariantBase* variant, layout::Layout<T> layout,
 }
 
 template <class T>
-size_t broadcast(std::string& msg, layout::Layout<T> layout, uint32_t exclude) {
+size_t broadcast(std::string& msg, const layout::Layout<T>& layout,
+                 uint32_t exclude) {
   size_t i = 0;
   msg.insert(0, 4, '\0');
   for (auto&& conn : layout.subs) {
@@ -140,8 +145,9 @@ size_t broadcast(std::string& msg, layout::Layout<T> layout, uint32_t exclude) {
 }
 
 template <class T>
-void routePackage(layout::Layout<T> layout, std::shared_ptr<T> connection,
-                  TSTRING pkg, callback::MeshPackageCallbackList<T> cbl,
+void routePackage(const layout::Layout<T>& layout,
+                  std::shared_ptr<T> connection, TSTRING pkg,
+                  callback::MeshPackageCallbackList<T>& cbl,
                   uint32_t receivedAt) {
   using namespace logger;
 
@@ -197,6 +203,28 @@ void routePackage(layout::Layout<T> layout, std::shared_ptr<T> connection,
   }
 }
 
+/**
+ * Let the mesh know whether the layout of the neighbour changed
+ */
+template <class T, class U>
+void nodeSyncDone(T& mesh, std::shared_ptr<U> conn, bool changed) {
+  if (changed) {
+    mesh.bumpVersion();
+    mesh.addTask([&mesh, nodeId = conn->nodeId]() {
+      mesh.changedConnectionCallbacks.execute(nodeId);
+    });
+  } else {
+    conn->nodeSyncTask.delay();
+    mesh.stability += std::min(1000 - mesh.stability, (size_t)25);
+  }
+}
+
+/**
+ * Adopt the tree received from the neighbour
+ *
+ * The subs of newTree are moved into the neighbour, so newTree should not be
+ * used afterwards.
+ */
 template <class T, class U>
 void handleNodeSync(T& mesh, protocol::NodeTree* newTree,
                     std::shared_ptr<U> conn) {
@@ -235,7 +263,7 @@ void handleNodeSync(T& mesh, protocol::NodeTree* newTree,
       Log(logger::S_TIME, "timeSyncTask(): %u\n", conn->nodeId);
       mesh.startTimeSync(conn);
     });
-    mesh.mScheduler->addTask(conn->timeSyncTask);
+    mesh.timers.addTimer(conn->timeSyncTask);
     if (conn->station)
       // We are STA, request time immediately
       conn->timeSyncTask.enable();
@@ -245,14 +273,61 @@ void handleNodeSync(T& mesh, protocol::NodeTree* newTree,
     conn->newConnection = false;
   }
 
-  if (conn->updateSubs(*newTree)) {
-    mesh.addTask([&mesh, nodeId = newTree->nodeId]() {
-      mesh.changedConnectionCallbacks.execute(nodeId);
-    });
-  } else {
-    conn->nodeSyncTask.delay();
-    mesh.stability += std::min(1000 - mesh.stability, (size_t)25);
+  nodeSyncDone<T, U>(mesh, conn, conn->updateSubs(std::move(*newTree)));
+}
+
+/**
+ * Send our layout to the neighbour
+ *
+ * Only the changes since the last layout send to this neighbour are send, or
+ * the full layout if the neighbour has no base to apply the changes to or does
+ * not support deltas (older nodes).
+ *
+ * \param reply Whether we are answering a NodeSyncDelta request
+ */
+template <class T, class U>
+bool sendNodeSync(T& mesh, std::shared_ptr<U> conn, bool reply = false) {
+  protocol::NodeSyncDelta delta;
+  if (conn->delta(mesh.nodeTreeSnapshot(), delta, reply)) {
+    Log(logger::SYNC, "sendNodeSync(): %zu changes for %u\n",
+        delta.changes.size(), conn->nodeId);
+    return send<protocol::NodeSyncDelta>(delta, conn, reply);
+  }
+  if (reply) {
+    auto nodeTree = conn->reply(mesh.nodeTreeSnapshot());
+    return send<protocol::NodeSyncReply>(nodeTree, conn, true);
+  }
+  auto nodeTree = conn->request(mesh.nodeTreeSnapshot());
+  return send<protocol::NodeSyncRequest>(nodeTree, conn);
+}
+
+template <class T, class U>
+void handleNodeSyncDelta(T& mesh, protocol::NodeSyncDelta* delta,
+                         std::shared_ptr<U> conn) {
+  Log(logger::SYNC, "handleNodeSyncDelta(): with %u, version %u->%u\n",
+      conn->nodeId, delta->baseVersion, delta->version);
+  conn->supportsDelta = true;
+  auto changed = false;
+  if (conn->newConnection || !conn->applyDelta((*delta), changed)) {
+    // Out of sync, fall back to exchanging the full layout. Only ask once,
+    // deltas that are still underway will not apply either.
+    if (conn->receivedVersion != 0 || conn->newConnection) {
+      Log(logger::SYNC,
+          "handleNodeSyncDelta(): version mismatch with %u, requesting full "
+          "sync\n",
+          conn->nodeId);
+      conn->receivedVersion = 0;
+      auto nodeTree = conn->request(mesh.nodeTreeSnapshot());
+      send<protocol::NodeSyncRequest>(nodeTree, conn, true);
+    }
+    return;
   }
+
+  nodeSyncDone<T, U>(mesh, conn, changed);
+  if (delta->reply)
+    conn->timeOutTask.disable();
+  else
+    sendNodeSync<T, U>(mesh, conn, true);
 }
 
 template <class T, typename U>
@@ -265,8 +340,15 @@ callback::MeshPackageCallbackList<U> addPackageCallback(
               uint32_t receivedAt) {
         auto typedVariant = (Variant<protocol::NodeSyncRequest>*)variant;
         auto newTree = typedVariant->package;
+        auto features = newTree->features;
         handleNodeSync<T, U>(mesh, newTree, connection);
-        auto nodeTree = connection->reply(std::move(mesh.asNodeTree()));
+        if (!connection->connected) return false;  // Closed, e.g. invalid subs
+        connection->supportsDelta =
+            features & protocol::FEATURE_NODE_SYNC_DELTA;
+        connection->receivedVersion = 1;
+        // A full request also means any delta request of ours is answered
+        connection->timeOutTask.disable();
+        auto nodeTree = connection->reply(mesh.nodeTreeSnapshot());
         send<protocol::NodeSyncReply>(nodeTree, connection, true);
         return false;
       });
@@ -278,11 +360,26 @@ callback::MeshPackageCallbackList<U> addPackageCallback(
               uint32_t receivedAt) {
         auto typedVariant = (Variant<protocol::NodeSyncReply>*)variant;
         auto newTree = typedVariant->package;
+        auto features = newTree->features;
         handleNodeSync<T, U>(mesh, newTree, connection);
+        if (!connection->connected) return false;  // Closed, e.g. invalid subs
+        connection->supportsDelta =
+            features & protocol::FEATURE_NODE_SYNC_DELTA;
+        connection->receivedVersion = 1;
         connection->timeOutTask.disable();
         return false;
       });
 
+  // Delta type, apply it and answer with our own changes if it was a request
+  callbackList.onPackage(
+      protocol::NODE_SYNC_DELTA,
+      [&mesh](VariantBase* variant, std::shared_ptr<U> connection,
+              uint32_t receivedAt) {
+        auto typedVariant = (Variant<protocol::NodeSyncDelta>*)variant;
+        handleNodeSyncDelta<T, U>(mesh, typedVariant->package, connection);
+        return false;
+      });
+
   return callbackList;
 }
 
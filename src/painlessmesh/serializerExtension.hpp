@@ -1,6 +1,7 @@
 #ifndef _PAINLESS_MESH_SERIALIZER_HPP_
 #define _PAINLESS_MESH_SERIALIZER_HPP_
 
+#include "painlessmesh/flatNodeTree.hpp"
 #include "painlessmesh/nodeTree.hpp"
 #include "typetraitsExtension.hpp"
 #include "serializer.hpp"
@@ -39,4 +40,65 @@ struct InternalSerializer<painlessmesh::protocol::NodeTree, void> {
   }
 };
 
+template <>
+struct InternalSerializer<painlessmesh::protocol::NodeTreeChange, void> {
+  static void deserialize(painlessmesh::protocol::NodeTreeChange* dest,
+                          const std::string& str, int& offset) {
+    SerializeHelper::deserialize(&dest->op, str, offset);
+    SerializeHelper::deserialize(&dest->parentId, str, offset);
+    SerializeHelper::deserialize(&dest->subtree, str, offset);
+  }
+
+  static void serialize(const painlessmesh::protocol::NodeTreeChange* source,
+                        std::string& str, int& offset) {
+    SerializeHelper::serialize(&source->op, str, offset);
+    SerializeHelper::serialize(&source->parentId, str, offset);
+    SerializeHelper::serialize(&source->subtree, str, offset);
+  }
+};
+
+/**
+ * Uses the same format as NodeTree: nodeId, root and the number of subs,
+ * followed by each of the subs
+ */
+template <>
+struct InternalSerializer<painlessmesh::protocol::FlatNodeTree, void> {
+  static void deserialize(painlessmesh::protocol::FlatNodeTree* dest,
+                          const std::string& str, int& offset) {
+    using namespace painlessmesh::protocol;
+    dest->nodes.clear();
+    // Nodes of which not all subs are read yet, with the number left to read
+    std::vector<std::pair<size_t, uint16_t>> open;
+    do {
+      FlatNode node;
+      bool root;
+      uint16_t length;
+      SerializeHelper::deserialize(&node.nodeId, str, offset);
+      SerializeHelper::deserialize(&root, str, offset);
+      SerializeHelper::deserialize(&length, str, offset);
+      if (root) node.flags |= FlatNode::ROOT;
+      open.push_back(std::make_pair(dest->nodes.size(), length));
+      dest->nodes.push_back(node);
+      while (!open.empty() && open.back().second == 0) {
+        auto index = open.back().first;
+        dest->nodes[index].subtreeSize = dest->nodes.size() - index;
+        open.pop_back();
+        if (!open.empty()) --open.back().second;
+      }
+    } while (!open.empty());
+  }
+
+  static void serialize(const painlessmesh::protocol::FlatNodeTree* source,
+                        std::string& str, int& offset) {
+    for (size_t i = 0; i < source->nodes.size(); ++i) {
+      auto&& node = source->nodes[i];
+      bool root = node.root();
+      uint16_t length = source->noSubs(i);
+      SerializeHelper::serialize(&node.nodeId, str, offset);
+      SerializeHelper::serialize(&root, str, offset);
+      SerializeHelper::serialize(&length, str, offset);
+    }
+  }
+};
+
 #endif
\ No newline at end of file
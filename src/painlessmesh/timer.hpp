@@ -0,0 +1,337 @@
+#ifndef _PAINLESS_MESH_TIMER_HPP_
+#define _PAINLESS_MESH_TIMER_HPP_
+
+#include <functional>
+
+#include "Arduino.h"
+#include "painlessmesh/configuration.hpp"
+
+#ifndef TIMER_WHEEL_TICK
+#define TIMER_WHEEL_TICK 10  // Resolution of the timer wheel (ms)
+#endif
+
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS 256  // Number of slots in the timer wheel
+#endif
+
+namespace painlessmesh {
+
+/**
+ * Timers for the internal periodic and delayed work of the mesh
+ *
+ * The scheduler checks every task on every execute(), so its overhead grows
+ * with the number of tasks. The timers of the mesh (e.g. the time outs and
+ * syncs of every connection) are kept in a hashed timer wheel instead, which
+ * is driven by a single task. Arming, re-arming and cancelling a timer are
+ * O(1). The task only runs when the earliest timer is due.
+ */
+namespace timer {
+
+class Wheel;
+
+/**
+ * A timer in the wheel
+ *
+ * The interface mirrors that of a (TaskScheduler) Task, intervals are in
+ * milliseconds (TASK_SECOND etc. can be used).
+ */
+class Timer {
+ public:
+  Timer() {}
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+  ~Timer();
+
+  void set(unsigned long aInterval, long aIterations,
+           std::function<void()> aCallback) {
+    interval = aInterval;
+    iterations = aIterations;
+    callback = aCallback;
+  }
+
+  void setCallback(std::function<void()> aCallback) { callback = aCallback; }
+
+  /**
+   * Enable the timer and run it as soon as possible
+   */
+  void enable() {
+    remaining = iterations;
+    enabled = true;
+    forceNextIteration();
+  }
+
+  /**
+   * Enable the timer and run it after aDelay (default: the interval)
+   */
+  void enableDelayed(unsigned long aDelay = 0) {
+    remaining = iterations;
+    enabled = true;
+    delay(aDelay);
+  }
+
+  void restartDelayed(unsigned long aDelay = 0) { enableDelayed(aDelay); }
+
+  void disable();
+
+  /**
+   * Postpone the next run until aDelay from now (default: the interval)
+   */
+  void delay(unsigned long aDelay = 0);
+
+  /**
+   * Run the timer as soon as possible
+   */
+  void forceNextIteration();
+
+  bool isEnabled() const { return enabled; }
+
+  unsigned long getInterval() const { return interval; }
+
+ protected:
+  Wheel* wheel = NULL;
+  unsigned long interval = 0;
+  long iterations = 0;
+  long remaining = 0;
+  std::function<void()> callback;
+  bool enabled = false;
+
+  /// Position in the wheel (slot -1 if not in the wheel)
+  int slot = -1;
+  uint32_t tick = 0;
+  Timer* prev = NULL;
+  Timer* next = NULL;
+
+  void fire();
+
+  friend class Wheel;
+};
+
+/**
+ * Hashed timer wheel
+ *
+ * Timers are put in the slot of the tick they expire, modulo the number of
+ * slots. When the wheel runs, the timers in the slots of the elapsed ticks
+ * that are due are run, timers further in the future stay until the wheel
+ * comes round again. The task of the wheel is delayed until the earliest tick
+ * a timer is armed for, so it does not run every tick.
+ */
+class Wheel {
+ public:
+  Wheel() {}
+  Wheel(const Wheel&) = delete;
+  Wheel& operator=(const Wheel&) = delete;
+
+  virtual ~Wheel() { stop(); }
+
+  void init(Scheduler& scheduler) {
+    this->scheduler = &scheduler;
+    task.set(TIMER_WHEEL_TICK, TASK_FOREVER, [this]() { this->run(); });
+    scheduler.addTask(task);
+  }
+
+  /**
+   * Let the timer use this wheel (similar to Scheduler::addTask)
+   */
+  void addTimer(Timer& timer) { timer.wheel = this; }
+
+  /**
+   * Number of timers waiting to run
+   */
+  size_t size() const { return armed; }
+
+  /**
+   * Run the timers that are due
+   */
+  void run() { advance(now() / TIMER_WHEEL_TICK); }
+
+  /**
+   * Cancel all timers and stop the wheel
+   *
+   * The task is removed from the scheduler as well, since the scheduler can
+   * be deleted before the wheel (e.g. by ~Mesh).
+   */
+  void stop() {
+    task.disable();
+    if (scheduler) scheduler->deleteTask(task);
+    scheduler = NULL;
+    for (int i = 0; i <= TIMER_WHEEL_SLOTS; ++i) {
+      while (slots[i]) {
+        auto timer = slots[i];
+        unlink(*timer);
+        timer->enabled = false;
+      }
+    }
+  }
+
+ protected:
+  Scheduler* scheduler = NULL;
+  Task task;
+  /// The slots of the wheel, the last one holds timers to run at once
+  Timer* slots[TIMER_WHEEL_SLOTS + 1] = {};
+  uint32_t currentTick = 0;
+  size_t armed = 0;
+  /// The tick the task is delayed until (only valid if the task is enabled)
+  uint32_t wakeTick = 0;
+  /// No timer in the slots is armed for an earlier tick than this
+  uint32_t nextTick = 0;
+  bool running = false;
+
+  static const int DUE = TIMER_WHEEL_SLOTS;
+
+  /**
+   * The current time in ms (tests can drive the wheel by overriding this)
+   */
+  virtual unsigned long now() { return millis(); }
+
+  void arm(Timer& timer, unsigned long delay) {
+    auto time = now();
+    if (armed == 0) currentTick = time / TIMER_WHEEL_TICK;
+    unlink(timer);
+    // Round up, a timer never runs early
+    uint32_t tick = (time + delay + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK;
+    if ((int32_t)(tick - currentTick) <= 0) tick = currentTick + 1;
+    if (armed == 0 || (int32_t)(tick - nextTick) < 0) nextTick = tick;
+    timer.tick = tick;
+    link(timer, tick % TIMER_WHEEL_SLOTS);
+    wake(tick);
+  }
+
+  void armNow(Timer& timer) {
+    if (armed == 0) currentTick = now() / TIMER_WHEEL_TICK;
+    unlink(timer);
+    link(timer, DUE);
+    wake(currentTick);
+  }
+
+  /**
+   * Make sure the task runs at tick, unless it runs earlier already
+   */
+  void wake(uint32_t tick) {
+    // advance() schedules the task itself once all due timers ran
+    if (running) return;
+    if (task.isEnabled() && (int32_t)(tick - wakeTick) >= 0) return;
+    wakeTick = tick;
+    int32_t delay = (uint32_t)(tick * TIMER_WHEEL_TICK) - (uint32_t)now();
+    if (delay <= 0) {
+      // (enable)Delayed(0) would wait an interval, so run at once instead
+      if (task.isEnabled())
+        task.forceNextIteration();
+      else
+        task.enable();
+    } else if (task.isEnabled()) {
+      task.delay(delay);
+    } else {
+      task.enableDelayed(delay);
+    }
+  }
+
+  /**
+   * The earliest tick a timer is armed for, given that there are armed timers
+   *
+   * Arming a timer keeps nextTick up to date, cancelling one can leave it
+   * early. In that case the slots are searched from nextTick on, so only the
+   * ticks the wheel sleeps anyway are visited. If all timers are a turn or
+   * more away this returns the tick a turn away, to search again from there.
+   */
+  uint32_t earliestTick() {
+    if (slots[DUE]) return currentTick;
+    if ((int32_t)(nextTick - currentTick) <= 0) nextTick = currentTick + 1;
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; ++i, ++nextTick) {
+      auto timer = slots[nextTick % TIMER_WHEEL_SLOTS];
+      for (; timer; timer = timer->next) {
+        if ((int32_t)(timer->tick - nextTick) <= 0) return nextTick;
+      }
+    }
+    return nextTick;
+  }
+
+  void link(Timer& timer, int slot) {
+    timer.slot = slot;
+    timer.prev = NULL;
+    timer.next = slots[slot];
+    if (timer.next) timer.next->prev = &timer;
+    slots[slot] = &timer;
+    ++armed;
+  }
+
+  void unlink(Timer& timer) {
+    if (timer.slot < 0) return;
+    if (timer.prev)
+      timer.prev->next = timer.next;
+    else
+      slots[timer.slot] = timer.next;
+    if (timer.next) timer.next->prev = timer.prev;
+    timer.slot = -1;
+    timer.prev = NULL;
+    timer.next = NULL;
+    --armed;
+  }
+
+  void advance(uint32_t nowTick) {
+    // Move the due timers of the elapsed slots to the due list first, so
+    // timers can be (re)armed and cancelled freely while running them.
+    auto ticks = nowTick - currentTick;
+    if (ticks > TIMER_WHEEL_SLOTS) ticks = TIMER_WHEEL_SLOTS;
+    for (uint32_t i = 1; i <= ticks; ++i) {
+      auto slot = (currentTick + i) % TIMER_WHEEL_SLOTS;
+      auto timer = slots[slot];
+      while (timer) {
+        auto next = timer->next;
+        if ((int32_t)(timer->tick - nowTick) <= 0) {
+          unlink(*timer);
+          link(*timer, DUE);
+        }
+        timer = next;
+      }
+    }
+    currentTick = nowTick;
+
+    running = true;
+    while (slots[DUE]) {
+      auto timer = slots[DUE];
+      unlink(*timer);
+      timer->fire();
+    }
+    running = false;
+    // Sleep until the next timer is due
+    task.disable();
+    if (armed > 0) wake(earliestTick());
+  }
+
+  friend class Timer;
+};
+
+// Only armed timers touch the wheel, so timers can outlive a stopped wheel
+inline Timer::~Timer() {
+  if (wheel && slot >= 0) wheel->unlink(*this);
+}
+
+inline void Timer::disable() {
+  enabled = false;
+  if (wheel && slot >= 0) wheel->unlink(*this);
+}
+
+inline void Timer::delay(unsigned long aDelay) {
+  if (!enabled || !wheel) return;
+  wheel->arm(*this, aDelay == 0 ? interval : aDelay);
+}
+
+inline void Timer::forceNextIteration() {
+  if (!enabled || !wheel) return;
+  wheel->armNow(*this);
+}
+
+inline void Timer::fire() {
+  if (!enabled) return;
+  if (iterations != TASK_FOREVER && --remaining <= 0) {
+    enabled = false;
+  } else {
+    wheel->arm(*this, interval);
+  }
+  // The callback can change the timer, so call a copy of it
+  auto cb = callback;
+  if (cb) cb();
+}
+}  // namespace timer
+}  // namespace painlessmesh
+#endif
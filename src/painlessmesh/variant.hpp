@@ -94,6 +94,69 @@ class Variant<protocol::Broadcast>
     SerializeHelper::deserialize(&package->msg, str, offset);
   }
 };
+template <>
+class Variant<protocol::BroadcastAt>
+    : public TypedVariantBase<protocol::BroadcastAt> {
+ public:
+  Variant(protocol::BroadcastAt* broadcast, bool cleanup = false)
+      : TypedVariantBase<protocol::BroadcastAt>(broadcast, cleanup) {}
+  void serializeTo(std::string& str, int& offset) override {
+    package->header.serializeTo(str, offset);
+    SerializeHelper::serialize(&package->from, str, offset);
+    SerializeHelper::serialize(&package->time, str, offset);
+    SerializeHelper::serialize(&package->msg, str, offset);
+  }
+  void deserializeFrom(const std::string& str) override {
+    int offset = 0;
+    package->header.deserializeFrom(str, offset);
+    SerializeHelper::deserialize(&package->from, str, offset);
+    SerializeHelper::deserialize(&package->time, str, offset);
+    SerializeHelper::deserialize(&package->msg, str, offset);
+  }
+};
+
+template <>
+class Variant<protocol::Request>
+    : public TypedVariantBase<protocol::Request> {
+ public:
+  Variant(protocol::Request* request, bool cleanup = false)
+      : TypedVariantBase<protocol::Request>(request, cleanup) {}
+  void serializeTo(std::string& str, int& offset) override {
+    package->header.serializeTo(str, offset);
+    SerializeHelper::serialize(&package->from, str, offset);
+    SerializeHelper::serialize(&package->id, str, offset);
+    SerializeHelper::serialize(&package->msg, str, offset);
+  }
+  void deserializeFrom(const std::string& str) override {
+    int offset = 0;
+    package->header.deserializeFrom(str, offset);
+    SerializeHelper::deserialize(&package->from, str, offset);
+    SerializeHelper::deserialize(&package->id, str, offset);
+    SerializeHelper::deserialize(&package->msg, str, offset);
+  }
+};
+
+template <>
+class Variant<protocol::Response>
+    : public TypedVariantBase<protocol::Response> {
+ public:
+  Variant(protocol::Response* response, bool cleanup = false)
+      : TypedVariantBase<protocol::Response>(response, cleanup) {}
+  void serializeTo(std::string& str, int& offset) override {
+    package->header.serializeTo(str, offset);
+    SerializeHelper::serialize(&package->from, str, offset);
+    SerializeHelper::serialize(&package->id, str, offset);
+    SerializeHelper::serialize(&package->msg, str, offset);
+  }
+  void deserializeFrom(const std::string& str) override {
+    int offset = 0;
+    package->header.deserializeFrom(str, offset);
+    SerializeHelper::deserialize(&package->from, str, offset);
+    SerializeHelper::deserialize(&package->id, str, offset);
+    SerializeHelper::deserialize(&package->msg, str, offset);
+  }
+};
+
 template <>
 class Variant<protocol::TimeSync>
     : public TypedVariantBase<protocol::TimeSync> {
@@ -113,6 +176,44 @@ class Variant<protocol::TimeSync>
   }
 };
 
+template <>
+class Variant<protocol::TimeBeacon>
+    : public TypedVariantBase<protocol::TimeBeacon> {
+ public:
+  Variant(protocol::TimeBeacon* timeBeacon, bool cleanup = false)
+      : TypedVariantBase<protocol::TimeBeacon>(timeBeacon, cleanup) {}
+  void serializeTo(std::string& str, int& offset) override {
+    package->header.serializeTo(str, offset);
+    SerializeHelper::serialize(&package->from, str, offset);
+    SerializeHelper::serialize(&package->msg, str, offset);
+  }
+  void deserializeFrom(const std::string& str) override {
+    int offset = 0;
+    package->header.deserializeFrom(str, offset);
+    SerializeHelper::deserialize(&package->from, str, offset);
+    SerializeHelper::deserialize(&package->msg, str, offset);
+  }
+};
+
+template <>
+class Variant<protocol::TimeSyncReport>
+    : public TypedVariantBase<protocol::TimeSyncReport> {
+ public:
+  Variant(protocol::TimeSyncReport* report, bool cleanup = false)
+      : TypedVariantBase<protocol::TimeSyncReport>(report, cleanup) {}
+  void serializeTo(std::string& str, int& offset) override {
+    package->header.serializeTo(str, offset);
+    SerializeHelper::serialize(&package->from, str, offset);
+    SerializeHelper::serialize(&package->msg, str, offset);
+  }
+  void deserializeFrom(const std::string& str) override {
+    int offset = 0;
+    package->header.deserializeFrom(str, offset);
+    SerializeHelper::deserialize(&package->from, str, offset);
+    SerializeHelper::deserialize(&package->msg, str, offset);
+  }
+};
+
 template <>
 class Variant<protocol::TimeDelay>
     : public TypedVariantBase<protocol::TimeDelay> {
@@ -144,6 +245,7 @@ class Variant<protocol::NodeSyncRequest>
     auto node = static_cast<protocol::NodeTree*>(package);
     // gdb_do_break();
     SerializeHelper::serialize(node, str, offset);
+    SerializeHelper::serialize(&package->features, str, offset);
   }
   void deserializeFrom(const std::string& str) override {
     int offset = 0;
@@ -151,6 +253,9 @@ class Variant<protocol::NodeSyncRequest>
     SerializeHelper::deserialize(&package->from, str, offset);
     auto node = static_cast<protocol::NodeTree*>(package);
     SerializeHelper::deserialize(node, str, offset);
+    // Older nodes do not send their features
+    if (offset < (int)str.size())
+      SerializeHelper::deserialize(&package->features, str, offset);
   }
 };
 
@@ -165,6 +270,7 @@ class Variant<protocol::NodeSyncReply>
     SerializeHelper::serialize(&package->from, str, offset);
     auto node = static_cast<protocol::NodeTree*>(package);
     SerializeHelper::serialize(node, str, offset);
+    SerializeHelper::serialize(&package->features, str, offset);
   }
   void deserializeFrom(const std::string& str) override {
     int offset = 0;
@@ -172,6 +278,9 @@ class Variant<protocol::NodeSyncReply>
     SerializeHelper::deserialize(&package->from, str, offset);
     auto node = static_cast<protocol::NodeTree*>(package);
     SerializeHelper::deserialize(node, str, offset);
+    // Older nodes do not send their features
+    if (offset < (int)str.size())
+      SerializeHelper::deserialize(&package->features, str, offset);
   }
 };
 
@@ -186,6 +295,7 @@ class Variant<protocol::NodeSync>
     SerializeHelper::serialize(&package->from, str, offset);
     auto node = static_cast<protocol::NodeTree*>(package);
     SerializeHelper::serialize(node, str, offset);
+    SerializeHelper::serialize(&package->features, str, offset);
   }
   void deserializeFrom(const std::string& str) override {
     int offset = 0;
@@ -193,6 +303,45 @@ class Variant<protocol::NodeSync>
     SerializeHelper::deserialize(&package->from, str, offset);
     auto node = static_cast<protocol::NodeTree*>(package);
     SerializeHelper::deserialize(node, str, offset);
+    // Older nodes do not send their features
+    if (offset < (int)str.size())
+      SerializeHelper::deserialize(&package->features, str, offset);
+  }
+};
+
+template <>
+class Variant<protocol::NodeSyncDelta>
+    : public TypedVariantBase<protocol::NodeSyncDelta> {
+ public:
+  Variant(protocol::NodeSyncDelta* nodeSyncDelta, bool cleanup = false)
+      : TypedVariantBase<protocol::NodeSyncDelta>(nodeSyncDelta, cleanup) {}
+  void serializeTo(std::string& str, int& offset) override {
+    package->header.serializeTo(str, offset);
+    SerializeHelper::serialize(&package->from, str, offset);
+    SerializeHelper::serialize(&package->baseVersion, str, offset);
+    SerializeHelper::serialize(&package->version, str, offset);
+    SerializeHelper::serialize(&package->hash, str, offset);
+    SerializeHelper::serialize(&package->reply, str, offset);
+    uint16_t length = package->changes.size();
+    SerializeHelper::serialize(&length, str, offset);
+    for (auto&& c : package->changes) {
+      SerializeHelper::serialize(&c, str, offset);
+    }
+  }
+  void deserializeFrom(const std::string& str) override {
+    int offset = 0;
+    package->header.deserializeFrom(str, offset);
+    SerializeHelper::deserialize(&package->from, str, offset);
+    SerializeHelper::deserialize(&package->baseVersion, str, offset);
+    SerializeHelper::deserialize(&package->version, str, offset);
+    SerializeHelper::deserialize(&package->hash, str, offset);
+    SerializeHelper::deserialize(&package->reply, str, offset);
+    uint16_t length;
+    SerializeHelper::deserialize(&length, str, offset);
+    package->changes.resize(length);
+    for (auto&& c : package->changes) {
+      SerializeHelper::deserialize(&c, str, offset);
+    }
   }
 };
 
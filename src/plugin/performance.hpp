@@ -175,7 +175,7 @@ void begin(T& mesh, double frequency = 2) {
     }
     tracker->operator[](pkg.from).lastId = pkg.id;
     tracker->operator[](pkg.from).delay.update(
-        ((int)mesh.getNodeTime() - pkg.time) / 1000);
+        (int64_t)(mesh.getNodeTime64() - mesh.expandTime(pkg.time)) / 1000);
     tracker->operator[](pkg.from).stability.update(pkg.stability);
     tracker->operator[](pkg.from).freeMemory.update(pkg.freeMemory);
     return false;
@@ -191,12 +191,17 @@ void begin(T& mesh, double frequency = 2) {
   });
 
   mesh.addTask(TASK_MINUTE, TASK_FOREVER, [tracker, &mesh]() {
-    for (auto&& pair : (*tracker)) {
-      if (mesh.isConnected(pair.first))
-        ++pair.second.present;
-      else
-        ++pair.second.absent;
-    }
+    // Count every node as absent, then correct that for the nodes found in
+    // a single pass over the layout
+    for (auto&& pair : (*tracker)) ++pair.second.absent;
+    mesh.forEachNode(
+        [&tracker](uint32_t id) {
+          auto it = tracker->find(id);
+          if (it == tracker->end()) return;
+          --it->second.absent;
+          ++it->second.present;
+        },
+        false);
     protocol::Variant var(tracker.get());
     TSTRING str;
     var.serializeTo(str);
@@ -7,6 +7,7 @@
 #include "catch_utils.hpp"
 
 #include "boost/asynctcp.hpp"
+#include "boost/runtime.hpp"
 
 WiFiClass WiFi;
 ESPClass ESP;
@@ -103,6 +104,42 @@ SCENARIO("We can setup and connect two meshes over localport") {
   REQUIRE(layout::size(mesh2.asNodeTree()) == 2);
 }
 
+SCENARIO("We can run the sockets of meshes on a threaded runtime") {
+  using namespace logger;
+  Scheduler scheduler;
+  Log.setLogLevel(ERROR);
+  host::Runtime runtime(2);
+
+  PMesh mesh1;
+  mesh1.init(&scheduler, 6843);
+  auto pServer = runtime.server(6843);
+  painlessmesh::tcp::initServer<MeshConnection, PMesh>(*pServer, mesh1);
+
+  PMesh mesh2;
+  mesh2.init(&scheduler, 6844);
+  auto pClient = runtime.client();
+  painlessmesh::tcp::connect<MeshConnection, PMesh>(
+      (*pClient), boost::asio::ip::address::from_string("127.0.0.1"), 6843,
+      mesh2);
+
+  runtime.start();
+  for (auto i = 0; i < 1000; ++i) {
+    runtime.poll();
+    mesh1.update();
+    mesh2.update();
+    if (layout::size(mesh1.asNodeTree()) == 2 &&
+        layout::size(mesh2.asNodeTree()) == 2)
+      break;
+    delay(1);
+  }
+  runtime.stop();
+
+  REQUIRE(layout::size(mesh1.asNodeTree()) == 2);
+  REQUIRE(layout::size(mesh2.asNodeTree()) == 2);
+  mesh1.stop();
+  mesh2.stop();
+}
+
 SCENARIO("The MeshTest class works correctly") {
   using namespace logger;
   Scheduler scheduler;
@@ -201,6 +238,43 @@ SCENARIO("Time sync works") {
   n.stop();
 }
 
+SCENARIO("Broadcasts can be delivered at a mesh time") {
+  using namespace logger;
+  Log.setLogLevel(ERROR);
+
+  Scheduler scheduler;
+  boost::asio::io_service io_service;
+  auto dim = runif(8, 15);
+  Nodes n(&scheduler, dim, io_service);
+
+  for (auto i = 0; i < 10000; ++i) {
+    n.update();
+    delay(10);
+  }
+
+  std::vector<uint64_t> delivered;
+  for (auto &&node : n.nodes) {
+    auto m = node.get();
+    m->onReceive([m, &delivered](auto id, auto msg) {
+      delivered.push_back(m->getNodeTime64());
+    });
+  }
+  auto at = n.nodes[0]->getNodeTime64() + 2000000;
+  n.nodes[0]->sendBroadcastAt(at, "Blink", true);
+  for (auto i = 0; i < 400; ++i) {
+    n.update();
+    delay(10);
+  }
+  REQUIRE(delivered.size() == n.size());
+  for (auto &&time : delivered) {
+    // The upper bits of the 64 bit time differ between nodes
+    int32_t late = (uint32_t)time - (uint32_t)at;
+    REQUIRE(late >= -10000);
+    REQUIRE(late < 50000);
+  }
+  n.stop();
+}
+
 SCENARIO("Rooting works") {
   using namespace logger;
   Log.setLogLevel(ERROR);
@@ -283,3 +283,40 @@ SCENARIO("SentBuffer receives strings and can be read in parts") {
     }
   }
 }
+
+SCENARIO("SentBuffer stamps the time right before a message is read") {
+  SentBuffer<std::string> sBuffer = SentBuffer<std::string>();
+  GIVEN("A message with a time stamp and one without") {
+    std::string stamped(10, 'a');
+    std::string plain(10, 'b');
+    sBuffer.push(plain);
+    sBuffer.push(stamped, true, 2);
+    THEN("Only the stamped message gets the time") {
+      uint32_t time = 0x01020304;
+      sBuffer.stamp(time);
+      auto data = sBuffer.readPtr(sBuffer.requestLength(10));
+      uint32_t written;
+      memcpy(&written, data + 2, sizeof(written));
+      REQUIRE(written == time);
+      REQUIRE(data[0] == 'a');
+      REQUIRE(data[6] == 'a');
+      sBuffer.freeRead();
+
+      sBuffer.stamp(time);
+      data = sBuffer.readPtr(sBuffer.requestLength(10));
+      REQUIRE(std::string(data, 10) == plain);
+    }
+  }
+}
+
+SCENARIO("ReceiveBuffer keeps the arrival time of each message") {
+  ReceiveBuffer<std::string> rBuffer = ReceiveBuffer<std::string>();
+  rBuffer.push("first", 10);
+  rBuffer.push("second", 20);
+  REQUIRE(rBuffer.frontReceivedAt() == 10);
+  rBuffer.pop_front();
+  REQUIRE(rBuffer.front() == "second");
+  REQUIRE(rBuffer.frontReceivedAt() == 20);
+  rBuffer.clear();
+  REQUIRE(rBuffer.frontReceivedAt() == 0);
+}
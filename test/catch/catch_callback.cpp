@@ -41,3 +41,89 @@ SCENARIO("CallbackMap should hold multiple callbacks by ID") {
     }
   }
 }
+
+SCENARIO("Package callbacks are called by priority until one consumes it") {
+  GIVEN("Callbacks with different priorities") {
+    auto cbl = callback::PackageCallbackList<int>();
+    std::vector<int> order;
+
+    cbl.onPackage(1, [&order](int z) { order.push_back(1); });
+    cbl.onPackage(
+        1,
+        [&order](int z) {
+          order.push_back(2);
+          return z > 0;
+        },
+        10);
+    cbl.onPackage(1, [&order](int z) { order.push_back(3); }, -10);
+
+    WHEN("None of them consumes the package") {
+      auto cnt = cbl.execute(1, 0);
+      THEN("They are all called, highest priority first") {
+        REQUIRE(cnt == 3);
+        REQUIRE(order == std::vector<int>({2, 1, 3}));
+      }
+    }
+
+    WHEN("A callback consumes the package") {
+      auto cnt = cbl.execute(1, 1);
+      THEN("The callbacks after it are not called") {
+        REQUIRE(cnt == 1);
+        REQUIRE(order == std::vector<int>({2}));
+      }
+    }
+  }
+
+  GIVEN("A callback for a type outside the dispatch table") {
+    auto cbl = callback::PackageCallbackList<int>();
+    auto i = 0;
+    cbl.onPackage(CALLBACK_TABLE_SIZE + 100, [&i](int z) { i += z; });
+    THEN("It is called as well") {
+      REQUIRE(cbl.execute(CALLBACK_TABLE_SIZE + 100, 2) == 1);
+      REQUIRE(i == 2);
+      REQUIRE(cbl.execute(CALLBACK_TABLE_SIZE + 101, 2) == 0);
+    }
+  }
+
+  GIVEN("A callback that adds callbacks while it runs") {
+    auto cbl = callback::PackageCallbackList<int>();
+    std::vector<int> order;
+    std::array<int, 64> data = {};
+    data[0] = 4;
+    cbl.onPackage(1, [&cbl, &order, data](int z) {
+      order.push_back(data[0]);
+      for (auto i = 0; i < 10; ++i)
+        cbl.onPackage(1, [&order](int z) { order.push_back(5); }, 10);
+      order.push_back(data[0]);
+    });
+    THEN("They are only called for the next package") {
+      REQUIRE(cbl.execute(1, 0) == 1);
+      REQUIRE(order == std::vector<int>({4, 4}));
+      order.clear();
+      REQUIRE(cbl.execute(1, 0) == 11);
+      REQUIRE(order.size() == 12);
+      REQUIRE(order.front() == 5);
+      REQUIRE(order.back() == 4);
+    }
+  }
+}
+
+SCENARIO("callback::Function holds small and large callables") {
+  auto i = 0;
+  callback::Function<int(int)> small = [&i](int z) { return i += z; };
+  std::array<int, 64> data = {};
+  data[10] = 5;
+  callback::Function<int(int)> large = [&i, data](int z) {
+    return i += data[10] * z;
+  };
+  REQUIRE(small(1) == 1);
+  REQUIRE(large(1) == 6);
+
+  auto copy = large;
+  REQUIRE(copy(1) == 11);
+  auto moved = std::move(small);
+  REQUIRE(!small);
+  REQUIRE(moved(1) == 12);
+  moved = copy;
+  REQUIRE(moved(1) == 17);
+}
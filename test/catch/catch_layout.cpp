@@ -11,8 +11,10 @@ typedef std::string TSTRING;
 
 #include "catch_utils.hpp"
 
+#include "painlessmesh/exporter.hpp"
 #include "painlessmesh/layout.hpp"
 #include "painlessmesh/protocol.hpp"
+#include "painlessmesh/router.hpp"
 
 using namespace painlessmesh;
 
@@ -175,3 +177,558 @@ SCENARIO("A layout neighbour knows when to update its sub") {
   }
 }
 
+
+SCENARIO("diff and apply turn one layout into another") {
+  GIVEN("Two random trees with the same top node") {
+    auto tree1 = createNodeTree(runif(1, 100), -1);
+    auto tree2 = createNodeTree(runif(1, 100), -1);
+    tree2.nodeId = tree1.nodeId;
+    auto changes = layout::diff(tree1, tree2);
+    THEN("Applying the changes to the first results in the second") {
+      REQUIRE(layout::apply(tree1, changes));
+      REQUIRE(tree1 == tree2);
+      REQUIRE(layout::size(tree1) == layout::size(tree2));
+      for (auto&& id : layout::asList(tree2))
+        REQUIRE(layout::contains(tree1, id));
+    }
+  }
+
+  GIVEN("A tree where one subtree moved to another node") {
+    auto tree1 = protocol::NodeTree(runif(1, 1000), false);
+    tree1.subs.push_back(createNodeTree(runif(1, 50), -1));
+    tree1.subs.push_back(createNodeTree(runif(1, 50), -1));
+    auto tree2 = tree1;
+    auto moved = tree2.subs.back();
+    tree2.subs.pop_back();
+    auto newParent = layout::find(tree2, layout::asList(tree2).back());
+    newParent->subs.push_back(moved);
+    auto changes = layout::diff(tree1, tree2);
+    THEN("Only the moved subtree is part of the changes") {
+      REQUIRE(changes.size() == 2);
+      REQUIRE(changes.front().op == protocol::NodeTreeChange::REMOVE);
+      REQUIRE(changes.back().subtree == moved);
+      REQUIRE(layout::apply(tree1, changes));
+      REQUIRE(tree1 == tree2);
+    }
+  }
+
+  GIVEN("Changes that refer to an unknown node") {
+    auto tree = createNodeTree(runif(1, 100), -1);
+    std::list<protocol::NodeTreeChange> changes;
+    changes.push_back(protocol::NodeTreeChange(
+        protocol::NodeTreeChange::REMOVE, tree.nodeId, protocol::NodeTree()));
+    THEN("apply fails") { REQUIRE(!layout::apply(tree, changes)); }
+
+    THEN("apply with an undo record fails and leaves the tree as it was") {
+      auto tree2 = createNodeTree(runif(1, 100), -1);
+      tree2.nodeId = tree.nodeId;
+      auto changes2 = layout::diff(tree, tree2);
+      changes2.splice(changes2.end(), changes);
+      auto original = tree;
+      std::list<protocol::NodeTreeChange> undo;
+      REQUIRE(!layout::apply(tree, changes2, undo));
+      REQUIRE(undo.empty());
+      REQUIRE(tree == original);
+      REQUIRE(layout::size(tree) == layout::size(original));
+    }
+  }
+}
+
+SCENARIO("NodeTree hashes identify the topology") {
+  GIVEN("A random tree and a copy with the subs in reverse order") {
+    auto tree1 = createNodeTree(runif(2, 255), -1);
+    auto tree2 = tree1;
+    tree2.subs.reverse();
+    THEN("They are equal") {
+      REQUIRE(tree1.hash() == tree2.hash());
+      REQUIRE(tree1 == tree2);
+    }
+
+    WHEN("A node deep in the copy is changed") {
+      auto id = layout::asList(tree2).back();
+      auto node = layout::findForUpdate(tree2, id);
+      node->subs.push_back(protocol::NodeTree(runif(1, 1000), false));
+      THEN("The hash changes and the trees are no longer equal") {
+        REQUIRE(tree1.hash() != tree2.hash());
+        REQUIRE(tree1 != tree2);
+      }
+    }
+
+    WHEN("A node is changed directly through the subs") {
+      REQUIRE(tree1 == tree2);
+      tree2.subs.front().subs.push_back(
+          protocol::NodeTree(runif(1, 1000), false));
+      THEN("The trees are no longer equal") { REQUIRE(tree1 != tree2); }
+    }
+
+    WHEN("The nodeId of the deepest node is changed") {
+      REQUIRE(tree1 == tree2);
+      auto node = &tree2;
+      while (!node->subs.empty()) node = &node->subs.back();
+      node->nodeId += 1;
+      THEN("The trees are no longer equal") { REQUIRE(tree1 != tree2); }
+    }
+
+    WHEN("A sub is excluded") {
+      auto excluded = layout::excludeRoute(protocol::NodeTree(tree2),
+                                           tree2.subs.front().nodeId);
+      THEN("The hash changes") { REQUIRE(excluded.hash() != tree1.hash()); }
+    }
+  }
+}
+
+SCENARIO("A neighbour only sends deltas once it has sent a full layout") {
+  GIVEN("A neighbour and our layout") {
+    layout::Neighbour neighbour(runif(1, 1000), false);
+    auto tree = createNodeTree(runif(2, 50), -1);
+    protocol::NodeSyncDelta delta;
+    THEN("No delta can be made before a full request") {
+      REQUIRE(!neighbour.delta(protocol::NodeTree(tree), delta));
+    }
+
+    WHEN("A full request was made to a neighbour without delta support") {
+      auto pkg = neighbour.request(protocol::NodeTree(tree));
+      THEN("Our request announces delta support, but no delta is made") {
+        REQUIRE((pkg.features & protocol::FEATURE_NODE_SYNC_DELTA) != 0);
+        REQUIRE(!neighbour.delta(protocol::NodeTree(tree), delta));
+      }
+    }
+
+    WHEN("A full request was made") {
+      neighbour.supportsDelta = true;
+      neighbour.request(protocol::NodeTree(tree));
+      auto tree2 = tree;
+      tree2.subs.pop_front();
+      THEN("The delta only holds the changes and applies on the remote") {
+        REQUIRE(neighbour.delta(protocol::NodeTree(tree2), delta));
+        REQUIRE(delta.baseVersion == 1);
+        REQUIRE(delta.version == 2);
+        REQUIRE(delta.changes.size() == 1);
+
+        layout::Neighbour remote(tree.nodeId, false);
+        remote.updateSubs(tree);
+        remote.receivedVersion = 1;
+        auto changed = false;
+        REQUIRE(remote.applyDelta(delta, changed));
+        REQUIRE(changed);
+        REQUIRE(remote.receivedVersion == 2);
+        REQUIRE(remote == tree2);
+        REQUIRE(remote.subtreeSize == layout::size(tree2));
+        REQUIRE(!remote.applyDelta(delta, changed));
+        REQUIRE(remote == tree2);
+      }
+
+      THEN("Nothing changed results in a delta without changes") {
+        REQUIRE(neighbour.delta(protocol::NodeTree(tree), delta));
+        REQUIRE(delta.changes.empty());
+        REQUIRE(delta.hash == tree.hash());
+
+        layout::Neighbour remote(tree.nodeId, false);
+        remote.updateSubs(tree);
+        remote.receivedVersion = 1;
+        auto changed = true;
+        REQUIRE(remote.applyDelta(delta, changed));
+        REQUIRE(!changed);
+        REQUIRE(remote.receivedVersion == 2);
+      }
+
+      THEN("A delta with the wrong hash is rejected and undone") {
+        REQUIRE(neighbour.delta(protocol::NodeTree(tree2), delta));
+        delta.hash = tree.hash();
+        layout::Neighbour remote(tree.nodeId, false);
+        remote.updateSubs(tree);
+        remote.receivedVersion = 1;
+        auto changed = false;
+        REQUIRE(!remote.applyDelta(delta, changed));
+        REQUIRE(remote == tree);
+        REQUIRE(remote.receivedVersion == 1);
+      }
+
+      THEN("A delta that adds a node twice is rejected and undone") {
+        auto tree3 = tree;
+        auto leaf = &tree3;
+        while (!leaf->subs.empty()) leaf = &leaf->subs.back();
+        leaf->subs.push_back(
+            protocol::NodeTree(tree.subs.front().nodeId, false));
+        REQUIRE(neighbour.delta(protocol::NodeTree(tree3), delta));
+        REQUIRE(delta.changes.size() == 1);
+        REQUIRE(delta.hash == tree3.hash());
+        layout::Neighbour remote(tree.nodeId, false);
+        remote.updateSubs(tree);
+        remote.receivedVersion = 1;
+        auto changed = false;
+        REQUIRE(!remote.applyDelta(delta, changed));
+        REQUIRE(remote == tree);
+      }
+    }
+  }
+}
+
+SCENARIO("A FlatNodeTree gives the same answers as a NodeTree") {
+  GIVEN("A random tree and its flat version") {
+    auto noNodes = runif(2, 255);
+    auto tree = createNodeTree(noNodes, (int)runif(0, noNodes) - 1);
+    auto flat = protocol::FlatNodeTree(tree);
+    THEN("The queries match") {
+      REQUIRE(layout::size(flat) == noNodes);
+      REQUIRE(layout::isRoot(flat) == layout::isRoot(tree));
+      REQUIRE(layout::isRooted(flat) == layout::isRooted(tree));
+      REQUIRE(layout::asList(flat) == layout::asList(tree));
+      REQUIRE(layout::asList(flat, false) == layout::asList(tree, false));
+      for (auto&& id : layout::asList(tree))
+        REQUIRE(layout::contains(flat, id));
+    }
+
+    THEN("It can be converted back") { REQUIRE(flat.toNodeTree() == tree); }
+
+    THEN("excludeRoute removes the same subs") {
+      auto exclude = tree.subs.front().nodeId;
+      auto flatExcluded =
+          layout::excludeRoute(protocol::FlatNodeTree(flat), exclude);
+      auto treeExcluded =
+          layout::excludeRoute(protocol::NodeTree(tree), exclude);
+      REQUIRE(flatExcluded.toNodeTree() == treeExcluded);
+      REQUIRE(layout::size(flatExcluded) == layout::size(treeExcluded));
+    }
+
+    THEN("It serializes to the same format as a NodeTree") {
+      std::string str1;
+      std::string str2;
+      int offset1 = 0;
+      int offset2 = 0;
+      SerializeHelper::serialize(&tree, str1, offset1);
+      SerializeHelper::serialize(&flat, str2, offset2);
+      REQUIRE(str1 == str2);
+
+      protocol::FlatNodeTree flat2;
+      offset2 = 0;
+      SerializeHelper::deserialize(&flat2, str1, offset2);
+      REQUIRE(offset1 == offset2);
+      REQUIRE(flat2 == flat);
+    }
+  }
+}
+
+class SnapshotLayout : public layout::Layout<layout::Neighbour> {
+ public:
+  SnapshotLayout(uint32_t id) { this->nodeId = id; }
+};
+
+SCENARIO("The layout snapshot is only rebuild when the version changes") {
+  GIVEN("A layout with a neighbour") {
+    SnapshotLayout lay(1);
+    auto neighbour = std::make_shared<layout::Neighbour>();
+    neighbour->updateSubs(createNodeTree(10, 2));
+    lay.subs.push_back(neighbour);
+    lay.bumpVersion();
+
+    THEN("Repeated calls return the same snapshot") {
+      auto snap1 = lay.nodeTreeSnapshot();
+      auto snap2 = lay.nodeTreeSnapshot();
+      REQUIRE(snap1 == snap2);
+      REQUIRE(layout::size(*snap1) == 1 + layout::size(*neighbour));
+      REQUIRE(lay.asNodeTree() == *snap1);
+    }
+
+    THEN("A new snapshot is made after bumpVersion") {
+      auto snap1 = lay.nodeTreeSnapshot();
+      neighbour->updateSubs(createNodeTree(5, 2));
+      REQUIRE(lay.nodeTreeSnapshot() == snap1);
+      lay.bumpVersion();
+      auto snap2 = lay.nodeTreeSnapshot();
+      REQUIRE(snap2 != snap1);
+      REQUIRE(layout::size(*snap2) == 1 + layout::size(*neighbour));
+      REQUIRE(layout::size(*snap1) != layout::size(*snap2));
+    }
+  }
+}
+
+SCENARIO("The neighbour aggregates match the layout queries") {
+  GIVEN("A layout with a number of random neighbours") {
+    SnapshotLayout lay(runif(1, 1000));
+    addRandomNeighbours(lay);
+    lay.bumpVersion();
+    auto tree = lay.asNodeTree();
+
+    THEN("size and isRooted give the same answer") {
+      REQUIRE(layout::size(lay) == layout::size(tree));
+      REQUIRE(layout::isRooted(lay) == layout::isRooted(tree));
+      for (auto&& s : lay.subs) {
+        if (s->nodeId == 0) {
+          REQUIRE(s->subtreeSize == 0);
+        } else {
+          REQUIRE(s->subtreeSize == layout::size(*s));
+          REQUIRE(s->containsRoot == layout::isRooted(*s));
+        }
+      }
+    }
+
+    THEN("rootHops gives the distance to the root") {
+      std::function<int(const protocol::NodeTree&, int)> depthOfRoot =
+          [&depthOfRoot](const protocol::NodeTree& t, int depth) {
+            if (t.root) return depth;
+            for (auto&& s : t.subs) {
+              auto found = depthOfRoot(s, depth + 1);
+              if (found >= 0) return found;
+            }
+            return -1;
+          };
+      REQUIRE(lay.rootHops() == depthOfRoot(tree, 0));
+      REQUIRE((lay.rootHops() > 0) == layout::isRooted(tree));
+    }
+
+    THEN("The aggregates are reset when the neighbour is cleared") {
+      auto neighbour = lay.subs.front();
+      auto size = layout::size(lay);
+      auto subSize = neighbour->subtreeSize;
+      neighbour->clear();
+      REQUIRE(neighbour->subtreeSize == 0);
+      REQUIRE(layout::size(lay) == size - subSize);
+    }
+  }
+
+  GIVEN("A neighbour whose subtree contains the root") {
+    auto tree = protocol::NodeTree(1, false);
+    tree.subs.push_back(protocol::NodeTree(2, false));
+    tree.subs.back().subs.push_back(protocol::NodeTree(3, true));
+    tree.subs.push_back(protocol::NodeTree(4, false));
+    layout::Neighbour neighbour;
+    neighbour.updateSubs(tree);
+    THEN("The aggregates are correct") {
+      REQUIRE(neighbour.subtreeSize == 4);
+      REQUIRE(neighbour.maxDepth == 2);
+      REQUIRE(neighbour.containsRoot);
+      REQUIRE(neighbour.rootHops == 2);
+    }
+  }
+}
+
+SCENARIO("The exporter writes a tree as JSON and CBOR") {
+  GIVEN("A small tree") {
+    auto tree = protocol::NodeTree(1, false);
+    tree.subs.push_back(protocol::NodeTree(2, true));
+    tree.subs.back().subs.push_back(protocol::NodeTree(300, false));
+    tree.subs.push_back(protocol::NodeTree(4294967295u, false));
+
+    THEN("toString gives the expected JSON") {
+      REQUIRE(tree.toString() ==
+              "{\"nodeId\":1,\"subs\":[{\"nodeId\":2,\"root\":true,\"subs\":"
+              "[{\"nodeId\":300}]},{\"nodeId\":4294967295}]}");
+      REQUIRE(tree.toString(true) == tree.toString());
+    }
+
+    THEN("writeJson can indent it") {
+      std::string json;
+      exporter::StringSink sink(json);
+      exporter::writeJson(tree, sink, true);
+      REQUIRE(json != tree.toString());
+      REQUIRE(json.find('\n') != std::string::npos);
+      json.erase(std::remove_if(json.begin(), json.end(), ::isspace),
+                 json.end());
+      REQUIRE(json == tree.toString());
+    }
+
+    THEN("A BufferSink gets the same JSON and reports overflow") {
+      char buffer[200];
+      exporter::BufferSink sink(buffer, sizeof(buffer));
+      exporter::writeJson(tree, sink);
+      REQUIRE(!sink.overflow());
+      REQUIRE(std::string(buffer, sink.length()) == tree.toString());
+
+      char small[10];
+      exporter::BufferSink smallSink(small, sizeof(small));
+      exporter::writeJson(tree, smallSink);
+      REQUIRE(smallSink.overflow());
+      REQUIRE(smallSink.length() == sink.length());
+      REQUIRE(std::string(small, sizeof(small)) ==
+              tree.toString().substr(0, sizeof(small)));
+    }
+
+    THEN("It is written as CBOR") {
+      std::string cbor;
+      exporter::StringSink sink(cbor);
+      exporter::writeCbor(protocol::NodeTree(300, true), sink);
+      REQUIRE(cbor ==
+              std::string("\xa2\x66nodeId\x19\x01\x2c\x64root\xf5", 17));
+    }
+  }
+}
+
+SCENARIO("We can go over all the nodes in a layout without a list") {
+  GIVEN("A layout with a number of random neighbours") {
+    SnapshotLayout lay(runif(1, 1000));
+    addRandomNeighbours(lay);
+    lay.bumpVersion();
+    auto lst = layout::asList(lay.asNodeTree(), false);
+
+    THEN("forEachNode visits the same nodes as asList") {
+      std::list<uint32_t> visited;
+      lay.forEachNode([&visited](uint32_t id) { visited.push_back(id); },
+                      false);
+      REQUIRE(visited == lst);
+      REQUIRE(lay.nodeCount(false) == lst.size());
+      REQUIRE(lay.nodeCount() == lst.size() + 1);
+    }
+
+    THEN("copyNodeIds copies as many as fit") {
+      std::vector<uint32_t> ids(lst.size());
+      REQUIRE(lay.copyNodeIds(ids.data(), ids.size(), false) == lst.size());
+      REQUIRE(std::list<uint32_t>(ids.begin(), ids.end()) == lst);
+
+      uint32_t first = 0;
+      REQUIRE(lay.copyNodeIds(&first, 1) == lst.size() + 1);
+      REQUIRE(first == lay.getNodeId());
+    }
+  }
+}
+
+SCENARIO("topologyEvents reports the changes between two layouts") {
+  GIVEN("A layout and a changed version of it") {
+    // 1 -> 2 -> 3, 1 -> 4 -> 5 (root)
+    auto tree1 = protocol::NodeTree(1, false);
+    tree1.subs.push_back(protocol::NodeTree(2, false));
+    tree1.subs.back().subs.push_back(protocol::NodeTree(3, false));
+    tree1.subs.push_back(protocol::NodeTree(4, false));
+    tree1.subs.back().subs.push_back(protocol::NodeTree(5, true));
+
+    // 1 -> 2 -> 3 -> 5 (root), 1 -> 6
+    auto tree2 = protocol::NodeTree(1, false);
+    tree2.subs.push_back(protocol::NodeTree(2, false));
+    tree2.subs.back().subs.push_back(protocol::NodeTree(3, false));
+    tree2.subs.back().subs.back().subs.push_back(protocol::NodeTree(5, true));
+    tree2.subs.push_back(protocol::NodeTree(6, false));
+
+    THEN("The same layout gives no events") {
+      REQUIRE(layout::topologyEvents(tree1, tree1).empty());
+    }
+
+    THEN("Nodes that left, moved and joined are reported with their path") {
+      auto events = layout::topologyEvents(tree1, tree2);
+      REQUIRE(events.size() == 3);
+      auto it = events.begin();
+      REQUIRE(it->type == layout::TopologyEvent::LEFT);
+      REQUIRE(it->nodeId == 4);
+      REQUIRE(it->path == std::vector<uint32_t>({1, 4}));
+      ++it;
+      REQUIRE(it->type == layout::TopologyEvent::MOVED);
+      REQUIRE(it->nodeId == 5);
+      REQUIRE(it->path == std::vector<uint32_t>({1, 2, 3, 5}));
+      ++it;
+      REQUIRE(it->type == layout::TopologyEvent::JOINED);
+      REQUIRE(it->nodeId == 6);
+      REQUIRE(it->path == std::vector<uint32_t>({1, 6}));
+    }
+
+    THEN("A change of root is reported") {
+      tree2.subs.back().root = true;
+      auto events = layout::topologyEvents(tree2, tree1);
+      REQUIRE(events.back().type == layout::TopologyEvent::ROOT_CHANGED);
+      REQUIRE(events.back().nodeId == 5);
+      REQUIRE(events.back().path == std::vector<uint32_t>({1, 4, 5}));
+    }
+  }
+}
+
+SCENARIO("We can query the route to a node") {
+  GIVEN("A layout with two neighbours") {
+    // 1 -> 2 -> 3 -> 4, 1 -> 5
+    SnapshotLayout lay(1);
+    auto tree2 = protocol::NodeTree(2, false);
+    tree2.subs.push_back(protocol::NodeTree(3, false));
+    tree2.subs.back().subs.push_back(protocol::NodeTree(4, false));
+    auto neighbour2 = std::make_shared<layout::Neighbour>();
+    neighbour2->updateSubs(tree2);
+    neighbour2->linkDelay = 1500;
+    auto neighbour5 = std::make_shared<layout::Neighbour>();
+    neighbour5->updateSubs(protocol::NodeTree(5, false));
+    lay.subs.push_back(neighbour2);
+    lay.subs.push_back(neighbour5);
+    lay.bumpVersion();
+
+    THEN("hopCount and pathTo give the route") {
+      REQUIRE(lay.hopCount(1) == 0);
+      REQUIRE(lay.hopCount(4) == 3);
+      REQUIRE(lay.hopCount(5) == 1);
+      REQUIRE(lay.hopCount(6) == -1);
+      REQUIRE(lay.pathTo(4) == std::vector<uint32_t>({1, 2, 3, 4}));
+      REQUIRE(lay.pathTo(1) == std::vector<uint32_t>({1}));
+      REQUIRE(lay.pathTo(6).empty());
+    }
+
+    THEN("The first hop and its delay are known") {
+      REQUIRE(lay.nextHop(3) == neighbour2);
+      REQUIRE(lay.nextHop(5) == neighbour5);
+      REQUIRE(lay.linkDelay(4) == 1500);
+      REQUIRE(lay.linkDelay(5) == -1);
+    }
+
+    THEN("The index is rebuild after the layout changed") {
+      REQUIRE(lay.hopCount(4) == 3);
+      neighbour5->updateSubs(protocol::NodeTree(6, false));
+      lay.bumpVersion();
+      REQUIRE(lay.hopCount(5) == -1);
+      REQUIRE(lay.hopCount(6) == 1);
+    }
+
+    THEN("findRoute uses the index") {
+      REQUIRE(router::findRoute<layout::Neighbour>(lay, 4) == neighbour2);
+      REQUIRE(router::findRoute<layout::Neighbour>(lay, 5) == neighbour5);
+      REQUIRE(!router::findRoute<layout::Neighbour>(lay, 6));
+    }
+
+    THEN("The index does not keep removed neighbours alive") {
+      REQUIRE(lay.nextHop(5) == neighbour5);
+      std::weak_ptr<layout::Neighbour> removed = neighbour5;
+      lay.subs.pop_back();
+      neighbour5 = NULL;
+      REQUIRE(removed.expired());
+      REQUIRE(!lay.nextHop(5));
+    }
+  }
+}
+
+SCENARIO("validSubs rejects loops and duplicate nodes") {
+  GIVEN("A neighbour and a valid tree") {
+    auto tree = createNodeTree(runif(1, 100), -1);
+    layout::Neighbour neighbour;
+    THEN("The tree is valid, before and after adopting it") {
+      REQUIRE(neighbour.validSubs(tree));
+      neighbour.updateSubs(tree);
+      REQUIRE(neighbour.validSubs(tree));
+    }
+
+    THEN("A tree with a different top node is not valid") {
+      neighbour.updateSubs(tree);
+      auto tree2 = tree;
+      tree2.nodeId = tree.nodeId + 1;
+      REQUIRE(!neighbour.validSubs(tree2));
+    }
+  }
+
+  GIVEN("A tree containing the neighbour or a duplicate node") {
+    auto tree = protocol::NodeTree(1, false);
+    tree.subs.push_back(protocol::NodeTree(2, false));
+    tree.subs.push_back(protocol::NodeTree(3, false));
+    layout::Neighbour neighbour;
+    neighbour.updateSubs(tree);
+    THEN("It is not valid") {
+      auto loop = tree;
+      loop.subs.back().subs.push_back(protocol::NodeTree(1, false));
+      REQUIRE(!neighbour.validSubs(loop));
+
+      auto duplicate = tree;
+      duplicate.subs.back().subs.push_back(protocol::NodeTree(2, false));
+      REQUIRE(!neighbour.validSubs(duplicate));
+      REQUIRE(!layout::Neighbour().validSubs(duplicate));
+    }
+  }
+}
+
+SCENARIO("NodeIdSet grows past its expected size") {
+  layout::NodeIdSet set(2);
+  uint32_t no = runif(10, 1000);
+  for (uint32_t i = 1; i <= no; ++i) REQUIRE(set.insert(i * 7919));
+  REQUIRE(set.size() == no);
+  for (uint32_t i = 1; i <= no; ++i) REQUIRE(!set.insert(i * 7919));
+  REQUIRE(set.insert(7918));
+}
@@ -0,0 +1,71 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch2/catch.hpp"
+
+#undef PAINLESSMESH_ENABLE_ARDUINO_STRING
+#define PAINLESSMESH_ENABLE_STD_STRING
+typedef std::string TSTRING;
+
+#include "catch_utils.hpp"
+
+#include "painlessmesh/layout.hpp"
+#include "painlessmesh/protocol.hpp"
+
+using namespace painlessmesh;
+
+// Count the allocations, to check that the topology is not copied needlessly.
+// This replaces the global operator new, so these tests have their own binary.
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  ++allocations;
+  void* p = malloc(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++allocations;
+  return malloc(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+SCENARIO("A NodeSync copies the layout at most once") {
+  GIVEN("A layout snapshot and a neighbour") {
+    auto layout = std::make_shared<protocol::NodeTree>(1, false);
+    layout->subs.push_back(createNodeTree(runif(20, 100), -1));
+    layout->subs.push_back(createNodeTree(runif(20, 100), -1));
+    auto size = layout::size(*layout);
+    auto snapshot = std::shared_ptr<const protocol::NodeTree>(layout);
+    layout::Neighbour neighbour;
+    neighbour.updateSubs(protocol::NodeTree(layout->subs.front().nodeId, false));
+    neighbour.supportsDelta = true;
+
+    THEN("Building a request allocates at most one node per node send") {
+      allocations = 0;
+      auto pkg = neighbour.request(snapshot);
+      REQUIRE(allocations <= size + 1);
+      REQUIRE(layout::size(pkg) == size - layout::size(layout->subs.front()));
+
+      AND_THEN("A delta without changes copies nothing") {
+        protocol::NodeSyncDelta delta;
+        allocations = 0;
+        REQUIRE(neighbour.delta(snapshot, delta));
+        REQUIRE(delta.changes.empty());
+        REQUIRE(allocations <= 2);
+      }
+    }
+
+    THEN("Adopting a received tree moves it") {
+      auto tree = protocol::NodeTree(*snapshot);
+      allocations = 0;
+      layout::Neighbour remote;
+      REQUIRE(remote.updateSubs(std::move(tree)));
+      REQUIRE(allocations <= 2);
+      REQUIRE(layout::size(remote) == size);
+    }
+  }
+}
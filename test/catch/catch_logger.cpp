@@ -4,6 +4,9 @@
 
 #include <Arduino.h>
 
+// Leave out S_TIME messages
+#define PAINLESSMESH_LOG_MASK 0xFFDF
+
 #include "painlessmesh/logger.hpp"
 using namespace painlessmesh::logger;
 
@@ -17,3 +20,27 @@ SCENARIO("We can log things") {
   Log(ERROR, "But not the next one\n");
   Log(S_TIME, "This should not be showing\n");
 }
+
+SCENARIO("Log types can be left out at compile time") {
+  static_assert(!enabled(S_TIME), "S_TIME should not be compiled in");
+  static_assert(enabled(ERROR), "ERROR should be compiled in");
+
+  size_t evaluated = 0;
+  auto arg = [&evaluated]() { return ++evaluated; };
+
+  GIVEN("A logger with S_TIME and ERROR enabled at run time") {
+    Log.setLogLevel(ERROR | S_TIME);
+    THEN("Types that are not compiled in stay disabled") {
+      REQUIRE(Log.isEnabled(ERROR));
+      REQUIRE(!Log.isEnabled(S_TIME));
+    }
+    THEN("Arguments are only evaluated for enabled types") {
+      Log(S_TIME, "Not compiled in %zu\n", arg());
+      REQUIRE(evaluated == 0);
+      Log(COMMUNICATION, "Not enabled %zu\n", arg());
+      REQUIRE(evaluated == 0);
+      Log(ERROR, "Enabled %zu\n", arg());
+      REQUIRE(evaluated == 1);
+    }
+  }
+}
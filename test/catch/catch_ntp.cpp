@@ -11,3 +11,185 @@
 using namespace painlessmesh;
 
 logger::LogClass Log;
+
+class TestTime : public ntp::MeshTime {
+ public:
+  using ntp::MeshTime::acceptBeacon;
+  using ntp::MeshTime::adjustTime;
+};
+
+SCENARIO("Small offsets are slewed in, large offsets are stepped") {
+  GIVEN("A mesh time") {
+    TestTime time;
+    uint32_t now = runif(0, 1000000000);
+    auto start = time.nodeTimeAt(now);
+    THEN("A small offset is applied gradually") {
+      time.adjustTime(1000, now);
+      REQUIRE(time.nodeTimeAt(now) == start);
+      // TIME_SYNC_SLEW_RATE is 500 ppm, so half of it is applied after 1s
+      REQUIRE(time.nodeTimeAt(now + 1000000) == start + 1000000 + 500);
+      REQUIRE(time.nodeTimeAt(now + 3000000) == start + 3000000 + 1000);
+      REQUIRE(time.nodeTimeAt(now + 4000000) == start + 4000000 + 1000);
+    }
+
+    THEN("A large offset is applied at once") {
+      time.adjustTime(-100000, now);
+      REQUIRE(time.nodeTimeAt(now) == start - 100000);
+    }
+  }
+
+  GIVEN("A mesh time started after more than 2^31 us of uptime") {
+    TestTime time;
+    uint32_t now = 3000000000;
+    THEN("A small offset is slewed in right away") {
+      time.adjustTime(1000, now);
+      REQUIRE(time.nodeTimeAt(now) == now);
+      REQUIRE(time.nodeTimeAt(now + 2000000) == now + 2000000 + 1000);
+    }
+  }
+}
+
+SCENARIO("The drift of the local clock is estimated and corrected") {
+  GIVEN("A local clock that runs 100 ppm too fast") {
+    TestTime time;
+    uint32_t local = 0;
+    auto reference = [&local]() { return local - local / 10000; };
+    int32_t offset = 0;
+    for (auto i = 0; i < 100; ++i) {
+      local += 30 * 1000000;
+      offset = reference() - time.nodeTimeAt(local);
+      time.adjustTime(offset, local);
+    }
+    THEN("The drift is estimated and the offset stays small") {
+      REQUIRE(time.drift() < -90000);
+      REQUIRE(time.drift() > -110000);
+      REQUIRE(std::abs(offset) < 500);
+    }
+  }
+
+  GIVEN("Offsets that arrive with the time beacons") {
+    TestTime time;
+    uint32_t local = 0;
+    auto reference = [&local]() { return local - local / 10000; };
+    for (auto i = 0; i < 100; ++i) {
+      local += TIME_BEACON_INTERVAL * 1000;
+      time.adjustTime(reference() - time.nodeTimeAt(local), local);
+    }
+    THEN("The drift is estimated as well") {
+      REQUIRE(time.drift() < -90000);
+      REQUIRE(time.drift() > -110000);
+    }
+  }
+}
+
+SCENARIO("The sample with the smallest delay is used") {
+  GIVEN("A burst of samples") {
+    ntp::SampleFilter filter;
+    filter.add(100, 2000, 0);
+    filter.add(-50, 500, 1000);
+    filter.add(300, 900, 2000);
+    THEN("The fastest sample is the best") {
+      REQUIRE(!filter.complete());
+      REQUIRE(filter.size() == 3);
+      REQUIRE(filter.best().offset == -50);
+      REQUIRE(filter.best().delay == 500);
+    }
+    THEN("It is complete after TIME_SYNC_BURST samples") {
+      filter.add(0, 1000, 3000);
+      REQUIRE(filter.complete());
+    }
+    THEN("An unfinished old burst is dropped") {
+      filter.add(0, 1000, 5000000);
+      REQUIRE(filter.size() == 1);
+    }
+  }
+}
+
+SCENARIO("The 64 bit mesh time does not roll over") {
+  GIVEN("A local clock about to roll over") {
+    TestTime time;
+    uint32_t local = 4000000000;
+    auto start = time.nodeTimeAt64(local);
+    THEN("The 64 bit time keeps counting after the roll over") {
+      local += 600000000;
+      auto end = time.nodeTimeAt64(local);
+      REQUIRE(end - start == 600000000);
+      REQUIRE((uint32_t)end == time.nodeTimeAt(local));
+    }
+    THEN("Times in the recent past are handled") {
+      time.nodeTimeAt64(local + 2000);
+      REQUIRE(time.nodeTimeAt64(local) == start);
+    }
+    THEN("It follows the mesh time when it is adjusted") {
+      time.adjustTime(1000000, local);
+      REQUIRE(time.nodeTimeAt64(local) - start == 1000000);
+    }
+  }
+
+  GIVEN("A mesh time started after more than 2^31 us of uptime") {
+    TestTime time;
+    uint32_t local = 3000000000;
+    THEN("The 64 bit time starts at the local time") {
+      REQUIRE(time.nodeTimeAt64(local) == local);
+      REQUIRE(time.nodeTimeAt64(local + 1000) == local + 1000);
+      REQUIRE(time.nodeTimeAt64(local - 1000) == local - 1000);
+    }
+  }
+}
+
+SCENARIO("Only noticeable time changes are passed on") {
+  GIVEN("A mesh time") {
+    TestTime time;
+    uint32_t now = runif(0, 1000000000);
+    THEN("Small changes are collected until they are large enough") {
+      time.adjustTime(TIME_SYNC_PROPAGATE_THRESHOLD / 2, now);
+      REQUIRE(!time.propagateTimeChange());
+      time.adjustTime(TIME_SYNC_PROPAGATE_THRESHOLD / 2, now);
+      REQUIRE(time.propagateTimeChange());
+      REQUIRE(!time.propagateTimeChange());
+    }
+    THEN("Changes that cancel out are not passed on") {
+      time.adjustTime(-800, now);
+      time.adjustTime(800, now);
+      REQUIRE(!time.propagateTimeChange());
+    }
+  }
+}
+
+SCENARIO("Time beacons are followed while they keep coming") {
+  GIVEN("A mesh time that received a beacon") {
+    TestTime time;
+    uint32_t now = runif(0, 1000000000);
+    REQUIRE(!time.beaconLocked(now));
+    REQUIRE(time.acceptBeacon(10, 5, 1, now));
+    REQUIRE(time.beaconLocked(now));
+    THEN("Old or repeated beacons are ignored") {
+      REQUIRE(!time.acceptBeacon(10, 5, 1, now + 1000));
+      REQUIRE(!time.acceptBeacon(11, 4, 1, now + 1000));
+      REQUIRE(time.acceptBeacon(10, 6, 1, now + 1000));
+    }
+    THEN("Without beacons the lock is lost and any beacon is accepted") {
+      now += 3 * TIME_BEACON_INTERVAL * 1000;
+      REQUIRE(!time.beaconLocked(now));
+      REQUIRE(time.acceptBeacon(11, 0, 2, now));
+    }
+    THEN("A lost lock stays lost when the local time rolls over") {
+      now += 3 * TIME_BEACON_INTERVAL * 1000;
+      REQUIRE(!time.beaconLocked(now));
+      now += (uint32_t)(-3 * TIME_BEACON_INTERVAL * 1000) + 1000;
+      REQUIRE(!time.beaconLocked(now));
+      REQUIRE(time.acceptBeacon(11, 0, 2, now));
+    }
+  }
+}
+
+SCENARIO("The quality of a time sync is tracked") {
+  ntp::SyncStats stats;
+  REQUIRE(stats.syncs == 0);
+  REQUIRE(stats.roundTrip == -1);
+  stats.synced(-300, 1200, 5000);
+  REQUIRE(stats.syncs == 1);
+  REQUIRE(stats.offset == -300);
+  REQUIRE(stats.errorBound == 1200);
+  REQUIRE(stats.sinceSync(7000) == 2000);
+}
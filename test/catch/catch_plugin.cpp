@@ -172,3 +172,64 @@ SCENARIO("We can add anonymous tasks to the taskscheduler") {
     }
   }
 }
+
+SCENARIO("Disabled anonymous tasks are reused") {
+  GIVEN("A task that has run") {
+    Scheduler mScheduler;
+    auto handler = plugin::PackageHandler<MockConnection>();
+    int i = 0;
+    auto task = handler.addTask(mScheduler, 0, 1, [&i]() { ++i; });
+    auto ptr = task.get();
+    mScheduler.execute();
+    mScheduler.execute();
+    REQUIRE(i == 1);
+    REQUIRE(!task->isEnabled());
+
+    WHEN("It is not held anymore") {
+      task = NULL;
+      THEN("The next task reuses it") {
+        auto task2 = handler.addTask(mScheduler, 0, 1, [&i]() { ++i; });
+        REQUIRE(task2.get() == ptr);
+        mScheduler.execute();
+        REQUIRE(i == 2);
+        handler.stop();
+      }
+    }
+
+    WHEN("It is still held") {
+      THEN("A new task is created, until it is released") {
+        auto task2 = handler.addTask(mScheduler, 0, 1, []() {});
+        REQUIRE(task2.get() != ptr);
+        task = NULL;
+        auto task3 = handler.addTask(mScheduler, 0, 1, []() {});
+        REQUIRE(task3.get() == ptr);
+        handler.stop();
+      }
+    }
+  }
+
+  GIVEN("A task whose OnDisable callback was replaced") {
+    Scheduler mScheduler;
+    auto handler = plugin::PackageHandler<MockConnection>();
+    auto held = handler.addTask(mScheduler, 0, TASK_FOREVER, []() {});
+    auto task = handler.addTask(mScheduler, 0, 1, []() {});
+    auto ptr = task.get();
+    auto disabled = false;
+    task->setOnDisable([&disabled]() { disabled = true; });
+    mScheduler.execute();
+    mScheduler.execute();
+    REQUIRE(disabled);
+    task = NULL;
+
+    THEN("releaseTasks returns it to the pool") {
+      auto task2 = handler.addTask(mScheduler, 0, 1, []() {});
+      REQUIRE(task2.get() != ptr);
+      handler.releaseTasks();
+      handler.releaseTasks();
+      handler.releaseTasks();
+      auto task3 = handler.addTask(mScheduler, 0, 1, []() {});
+      REQUIRE(task3.get() == ptr);
+      handler.stop();
+    }
+  }
+}
@@ -0,0 +1,115 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch2/catch.hpp"
+
+#include "Arduino.h"
+
+#include "catch_wheel.hpp"
+
+#include "painlessmesh/request.hpp"
+
+using namespace painlessmesh;
+
+SCENARIO("Requests are completed by their key") {
+  Scheduler scheduler;
+  TestWheel wheel;
+  wheel.init(scheduler);
+  request::Tracker<std::string> tracker;
+  tracker.init(wheel);
+
+  GIVEN("A couple of requests in flight") {
+    auto id1 = tracker.nextId();
+    auto id2 = tracker.nextId();
+    REQUIRE(id1 != id2);
+    auto pending1 = tracker.start(id1, 1000);
+    auto pending2 = tracker.start(id2, 1000);
+    REQUIRE(tracker.size() == 2);
+
+    std::string reply;
+    request::Status status = request::PENDING;
+    pending2->then([&](auto s, auto& r) {
+      status = s;
+      reply = r;
+    });
+
+    THEN("Each is completed by its own answer") {
+      REQUIRE(tracker.complete(id2, "two"));
+      REQUIRE(status == request::DONE);
+      REQUIRE(reply == "two");
+      REQUIRE(!pending1->done());
+      REQUIRE(tracker.size() == 1);
+
+      REQUIRE(tracker.complete(id1, "one"));
+      REQUIRE(pending1->result() == "one");
+      REQUIRE(tracker.size() == 0);
+    }
+
+    THEN("An answer without request is ignored") {
+      REQUIRE(!tracker.complete(id2 + 1, "three"));
+      REQUIRE(tracker.complete(id2, "two"));
+      REQUIRE(!tracker.complete(id2, "two again"));
+      REQUIRE(reply == "two");
+    }
+
+    THEN("A request can be cancelled") {
+      pending2->cancel();
+      REQUIRE(status == request::CANCELLED);
+      REQUIRE(tracker.size() == 1);
+      REQUIRE(!tracker.complete(id2, "two"));
+    }
+
+    THEN("Callbacks added when done are called at once") {
+      tracker.fail(id1);
+      auto called = false;
+      pending1->then([&called](auto s, auto& r) {
+        called = true;
+        REQUIRE(s == request::FAILED);
+      });
+      REQUIRE(called);
+    }
+
+    THEN("Stopping the tracker cancels all requests") {
+      tracker.stop();
+      REQUIRE(pending1->status() == request::CANCELLED);
+      REQUIRE(status == request::CANCELLED);
+      REQUIRE(tracker.size() == 0);
+    }
+    tracker.stop();
+  }
+
+  GIVEN("A request with a short time out") {
+    auto pending = tracker.start(tracker.nextId(), 20);
+    THEN("It times out when there is no answer") {
+      wheel.runFor(19);
+      REQUIRE(!pending->done());
+      wheel.runFor(TIMER_WHEEL_TICK);
+      REQUIRE(pending->status() == request::TIMEOUT);
+      REQUIRE(tracker.size() == 0);
+    }
+  }
+
+  GIVEN("Multiple requests with the same key") {
+    auto pending1 = tracker.start(10, 1000);
+    auto pending2 = tracker.start(10, 1000);
+    THEN("One answer completes them all") {
+      REQUIRE(tracker.complete(10, "ten"));
+      REQUIRE(pending1->result() == "ten");
+      REQUIRE(pending2->result() == "ten");
+    }
+  }
+
+  GIVEN("Delay measurements of the same node, keyed by their time stamp") {
+    request::Tracker<int32_t, std::pair<uint32_t, uint32_t>> delays;
+    delays.init(wheel);
+    auto pending1 = delays.start(std::make_pair(5u, 100u), 1000);
+    auto pending2 = delays.start(std::make_pair(5u, 200u), 1000);
+    THEN("An answer only completes the request it belongs to") {
+      REQUIRE(!delays.complete(std::make_pair(5u, 150u), 1));
+      REQUIRE(delays.complete(std::make_pair(5u, 200u), 2));
+      REQUIRE(!pending1->done());
+      REQUIRE(pending2->result() == 2);
+      REQUIRE(delays.complete(std::make_pair(5u, 100u), 3));
+      REQUIRE(pending1->result() == 3);
+    }
+  }
+}
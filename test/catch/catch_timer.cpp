@@ -0,0 +1,128 @@
+#define CATCH_CONFIG_MAIN
+
+#include "catch2/catch.hpp"
+
+#include "Arduino.h"
+
+#include "catch_wheel.hpp"
+
+using namespace painlessmesh;
+
+SCENARIO("Timers in the wheel run like tasks") {
+  Scheduler scheduler;
+  TestWheel wheel;
+  wheel.init(scheduler);
+
+  GIVEN("A timer that runs every 20ms") {
+    int i = 0;
+    timer::Timer timer;
+    timer.set(20 * TASK_MILLISECOND, TASK_FOREVER, [&i]() { ++i; });
+    wheel.addTimer(timer);
+    timer.enableDelayed();
+    REQUIRE(wheel.size() == 1);
+    THEN("It runs periodically") {
+      wheel.runFor(110);
+      REQUIRE(i == 5);
+    }
+    THEN("It does not run when disabled") {
+      timer.disable();
+      REQUIRE(wheel.size() == 0);
+      wheel.runFor(50);
+      REQUIRE(i == 0);
+    }
+    THEN("It runs at once when forced") {
+      timer.forceNextIteration();
+      wheel.run();
+      REQUIRE(i == 1);
+    }
+    THEN("It can be postponed") {
+      timer.delay(300);
+      wheel.runFor(299);
+      REQUIRE(i == 0);
+      wheel.runFor(1);
+      REQUIRE(i == 1);
+    }
+    THEN("The wheel knows when it is due") {
+      timer::Timer later;
+      later.set(500, TASK_ONCE, []() {});
+      wheel.addTimer(later);
+      later.enableDelayed();
+      REQUIRE(wheel.earliestTick() == (wheel.time + 20) / TIMER_WHEEL_TICK);
+      timer.disable();
+      REQUIRE(wheel.earliestTick() == (wheel.time + 500) / TIMER_WHEEL_TICK);
+    }
+  }
+
+  GIVEN("A timer that runs once") {
+    int i = 0;
+    timer::Timer timer;
+    timer.set(10 * TASK_MILLISECOND, TASK_ONCE, [&i]() { ++i; });
+    wheel.addTimer(timer);
+    timer.enableDelayed();
+    THEN("It is disabled after running") {
+      wheel.runFor(50);
+      REQUIRE(i == 1);
+      REQUIRE(!timer.isEnabled());
+      REQUIRE(wheel.size() == 0);
+      timer.restartDelayed();
+      wheel.runFor(50);
+      REQUIRE(i == 2);
+    }
+  }
+
+  GIVEN("A timer further away than a turn of the wheel") {
+    int i = 0;
+    timer::Timer timer;
+    auto turn = TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK;
+    timer.set(turn + 50, TASK_ONCE, [&i]() { ++i; });
+    wheel.addTimer(timer);
+    timer.enableDelayed();
+    THEN("It waits for the next turn") {
+      wheel.runFor(turn);
+      REQUIRE(i == 0);
+      wheel.runFor(50);
+      REQUIRE(i == 1);
+    }
+    THEN("The wheel looks at most a turn ahead for it") {
+      timer::Timer sooner;
+      sooner.set(20, TASK_ONCE, []() {});
+      wheel.addTimer(sooner);
+      sooner.enableDelayed();
+      auto tick = (wheel.time + 20) / TIMER_WHEEL_TICK;
+      REQUIRE(wheel.earliestTick() == tick);
+      sooner.disable();
+      REQUIRE(wheel.earliestTick() == tick + TIMER_WHEEL_SLOTS);
+      REQUIRE(wheel.earliestTick() ==
+              (wheel.time + turn + 50 + TIMER_WHEEL_TICK - 1) /
+                  TIMER_WHEEL_TICK);
+    }
+    THEN("It is not missed when the wheel runs late") {
+      wheel.time += turn + 100;
+      wheel.run();
+      REQUIRE(i == 1);
+    }
+  }
+
+  GIVEN("Timers that change each other while running") {
+    int i = 0;
+    timer::Timer timer1;
+    timer::Timer timer2;
+    timer1.set(10, TASK_FOREVER, [&]() {
+      ++i;
+      timer2.disable();
+    });
+    timer2.set(10, TASK_FOREVER, [&]() {
+      ++i;
+      timer1.disable();
+    });
+    wheel.addTimer(timer1);
+    wheel.addTimer(timer2);
+    timer1.enable();
+    timer2.enable();
+    THEN("Only one of them runs") {
+      wheel.runFor(50);
+      REQUIRE(wheel.size() == 1);
+      REQUIRE(i == 5);
+    }
+  }
+}
@@ -6,7 +6,9 @@
  */
 
 #include <limits>
+#include <memory>
 #include <random>
+#include <type_traits>
 
 #include "painlessmesh/protocol.hpp"
 
@@ -106,6 +108,27 @@ painlessmesh::protocol::NodeTree createNodeTree(int nodes, int contains_root) {
   return pkg;
 }
 
+/**
+ * Add one to five neighbours with random subtrees to the layout, followed by a
+ * neighbour that has not synced yet
+ *
+ * The first neighbour sometimes contains the root of the mesh. Call
+ * bumpVersion on the layout afterwards.
+ */
+template <class L>
+void addRandomNeighbours(L& layout) {
+  typedef typename std::decay<decltype(layout.subs)>::type::value_type::
+      element_type Neighbour;
+  auto noNeighbours = runif(1, 5);
+  for (uint32_t i = 0; i < noNeighbours; ++i) {
+    auto neighbour = std::make_shared<Neighbour>();
+    auto rt = i == 0 ? (int)runif(0, 50) : -1;
+    neighbour->updateSubs(createNodeTree(runif(1, 50), rt));
+    layout.subs.push_back(neighbour);
+  }
+  layout.subs.push_back(std::make_shared<Neighbour>());
+}
+
 painlessmesh::protocol::NodeSyncReply createNodeSyncReply(
     int nodes = -1, bool contains_root = true) {
   auto pkg = painlessmesh::protocol::NodeSyncReply();
@@ -0,0 +1,29 @@
+#ifndef CATCH_WHEEL_H_
+#define CATCH_WHEEL_H_
+
+/*
+ * A timer wheel that runs on a clock driven by the test
+ */
+
+#include "painlessmesh/timer.hpp"
+
+class TestWheel : public painlessmesh::timer::Wheel {
+ public:
+  using painlessmesh::timer::Wheel::earliestTick;
+
+  unsigned long time = 1000;
+
+  // Advance the clock by the given number of milliseconds, running the wheel
+  // every millisecond
+  void runFor(unsigned long ms) {
+    for (unsigned long i = 0; i < ms; ++i) {
+      ++time;
+      run();
+    }
+  }
+
+ protected:
+  unsigned long now() override { return time; }
+};
+
+#endif